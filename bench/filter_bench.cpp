@@ -0,0 +1,124 @@
+/**
+* @file filter_bench.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Measures the glob matching of --include and --exclude.
+ *
+ * Checks a table of patterns and paths with known results first, then
+ * matches synthetic paths against a typical set of exclude patterns.
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <littlesmith/util/Arguments.h>
+#include "../scan_filter.h"
+
+/**
+ * @brief A pattern, an entry and whether the pattern has to match it
+*/
+struct glob_case {
+    const char* glob;
+    const char* path;
+    bool directory;
+    bool expected;
+};
+
+static const glob_case CASES[] = {
+        {"**/foo", "foo", false, true},
+        {"**/foo", "x/foo", false, true},
+        {"**/foo", "x/y/foo", false, true},
+        {"**/foo", "barfoo", false, false},
+        {"**/foo", "x/barfoo", false, false},
+        {"a/**/b", "a/b", false, true},
+        {"a/**/b", "a/x/b", false, true},
+        {"a/**/b", "a/x/y/b", false, true},
+        {"a/**/b", "a/xb", false, false},
+        {"a/**/b", "a/x/yb", false, false},
+        {"**/cache", "cache", true, true},
+        {"**/cache", "src/cache", true, true},
+        {"**/cache", "mycache", true, false},
+        {"**/cache", "src/mycache", true, false},
+        {"src/**", "src/a/b.txt", false, true},
+        {"src/**", "other/a.txt", false, false},
+        {"**/*.tmp", "a/b/c.tmp", false, true},
+        {"**/*.tmp", "a/b/c.txt", false, false},
+        {"build/", "build", true, true},
+        {"build/", "build", false, false},
+        {"*.jp[e]g", "photo.jpeg", false, true},
+        {"img_??.png", "img_01.png", false, true},
+        {"img_??.png", "img_001.png", false, false},
+};
+
+/**
+ * @brief Runs the cases
+ *
+ * @returns true if every pattern matched exactly the entries it should
+*/
+static bool check() {
+    bool ok = true;
+    for (const auto& c: CASES) {
+        glob_set set;
+        set.add(c.glob);
+        std::string_view path(c.path);
+        auto slash = path.rfind('/');
+        auto name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+        if (set.matches(path, name, c.directory) != c.expected) {
+            std::cerr << c.glob << (c.expected ? " does not match " : " matches ") << c.path
+                      << (c.directory ? " (directory)" : "") << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Creates relative paths like 2019/holiday/cache/IMG_1234.jpg
+*/
+static std::vector<std::string> generate(size_t count) {
+    std::mt19937 random(42);
+    const char* folders[] = {"holiday", "node_modules", "build", "mycache", "cache", "src"};
+    const char* extensions[] = {".jpg", ".tmp", ".png", ".o", ".txt"};
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        paths.push_back(std::to_string(2010 + random() % 15) + "/" + folders[random() % 6] + "/" +
+                        folders[random() % 6] + "/IMG_" + std::to_string(random() % 100000) +
+                        extensions[random() % 5]);
+    }
+    return paths;
+}
+
+int main(int argc, char* argv[]) {
+    littlesmith::arguments arguments;
+    arguments.setDescription("Measures the glob matching of --include and --exclude");
+    arguments.defineValue("count", "n", littlesmith::argument_type::INT, "1000000", true);
+    arguments.addDescription("count", "The number of paths");
+    if (!arguments.parse(argc, argv)) {
+        return -1;
+    }
+    arguments.printHeader();
+    if (!check()) {
+        return 1;
+    }
+    auto count = static_cast<size_t>(arguments.getValue<int>("count"));
+    auto paths = generate(count);
+    glob_set set;
+    for (auto glob: {"node_modules", "*.tmp", "**/cache/**", "build/", "src/**/*.o", "**/IMG_1*.png", "[0-9]*.txt"}) {
+        set.add(glob);
+    }
+    size_t matched = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& path: paths) {
+        auto name = std::string_view(path).substr(path.rfind('/') + 1);
+        matched += set.matches(path, name, false);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << std::left << std::setw(22) << "glob_set"
+              << std::right << std::setw(10) << std::fixed << std::setprecision(4) << elapsed.count() << " s "
+              << std::setw(14) << std::setprecision(0) << count / elapsed.count() << " paths/s "
+              << matched << " matched" << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+* @file manifest_writer_bench.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Measures the throughput of the manifest_writer.
+ *
+ * Writes a number of synthetic paths once with std::ofstream and std::endl
+ * (the way scan used to write the manifests) and once with the
+ * manifest_writer in direct and in background mode. Before that, it checks
+ * that lines longer than a buffer are written correctly.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <littlesmith/util/Arguments.h>
+#include "../manifest_writer.h"
+
+/**
+ * @brief Builds the n-th synthetic path, roughly as long as a real media path
+*/
+static void make_path(std::string& path, long n) {
+    path = "/srv/archive/media/";
+    path += std::to_string(n % 97);
+    path += "/";
+    path += std::to_string(n % 1009);
+    path += "/IMG_";
+    path += std::to_string(n);
+    path += "_holiday_2024.jpg";
+}
+
+/**
+ * @brief Runs one measurement and prints the result
+*/
+static void measure(const std::string& name, const std::filesystem::path& file, long count,
+                    const std::function<uint64_t()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    auto bytes = run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(24) << name
+              << std::right << std::setw(12) << count << " paths "
+              << std::setw(10) << std::fixed << std::setprecision(3) << elapsed.count() << " s "
+              << std::setw(10) << std::setprecision(1) << (bytes / 1e6) / elapsed.count() << " MB/s" << std::endl;
+    std::filesystem::remove(file);
+}
+
+/**
+ * @brief Writes lines longer than the buffer between short ones and compares the file
+ *
+ * @returns true if the file contains exactly the lines written
+*/
+static bool check_long_lines(const std::filesystem::path& file) {
+    const size_t sizes[] = {5000, 4000, 100, 9000, 4095, 4096, 3, 12000, 1};
+    for (bool background: {false, true}) {
+        std::string expected;
+        {
+            manifest_writer out(file, background, 4096);
+            for (size_t i = 0; i < std::size(sizes); i++) {
+                std::string line(sizes[i], static_cast<char>('a' + i));
+                out.write(line);
+                expected += line + '\n';
+            }
+            out.close();
+        }
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        std::filesystem::remove(file);
+        if (content.str() != expected) {
+            std::cerr << "Lines longer than the buffer were not written correctly"
+                      << (background ? " in background mode" : "") << "!" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    littlesmith::arguments arguments;
+    arguments.setDescription("Measures how fast manifests can be written");
+    arguments.defineValue("count", "n", littlesmith::argument_type::INT, "10000000", true);
+    arguments.addDescription("count", "The number of paths to write");
+    arguments.defineValue("endl-count", "e", littlesmith::argument_type::INT, "1000000", true);
+    arguments.addDescription("endl-count", "The number of paths to write with std::endl (0 to skip)");
+    arguments.defineValue("file", "f", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("file", "The file to write to. If omitted, a file in the temp directory is used");
+    if (!arguments.parse(argc, argv)) {
+        return -1;
+    }
+    arguments.printHeader();
+    auto count = arguments.getValue<long>("count");
+    auto endl_count = arguments.getValue<long>("endl-count");
+    std::filesystem::path file = arguments.getValue<std::string>("file");
+    if (file.empty()) {
+        file = std::filesystem::temp_directory_path() / "multirenamer_manifest_bench.txt";
+    }
+
+    if (!check_long_lines(file)) {
+        return -1;
+    }
+    if (endl_count > 0) {
+        measure("std::endl", file, endl_count, [&] {
+            std::ofstream out(file);
+            std::string path;
+            uint64_t bytes = 0;
+            for (long i = 0; i < endl_count; i++) {
+                make_path(path, i);
+                out << path << std::endl;
+                bytes += path.size() + 1;
+            }
+            return bytes;
+        });
+    }
+    for (bool background: {false, true}) {
+        measure(background ? "manifest_writer (bg)" : "manifest_writer", file, count, [&] {
+            manifest_writer out(file, background);
+            std::string path;
+            for (long i = 0; i < count; i++) {
+                make_path(path, i);
+                out.write(path);
+            }
+            out.sync();
+            out.close();
+            return out.bytes();
+        });
+    }
+    return 0;
+}
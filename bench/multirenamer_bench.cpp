@@ -0,0 +1,303 @@
+/**
+* @file multirenamer_bench.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Measures scan, rename, manifest parsing and hashString on a synthetic tree.
+ *
+ * Generates a directory tree, then scans it, parses the manifest, hashes
+ * every path and renames every file, repeatedly. The results are printed
+ * and can be written as JSON and compared against the JSON of an earlier
+ * run, so regressions show up before a build is rolled out.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <littlesmith/crypto/SHA256.h>
+#include <littlesmith/util/Arguments.h>
+#include "../manifest_reader.h"
+#include "../manifest_writer.h"
+#include "../multirenamer.h"
+
+/**
+ * @brief The shape of the synthetic tree
+*/
+struct tree_shape {
+    unsigned fan_out;
+    unsigned depth;
+    unsigned files;
+    unsigned name_length;
+};
+
+/**
+ * @brief The timings of one phase
+*/
+struct phase_result {
+    std::vector<double> seconds;
+    size_t items{0};
+
+    [[nodiscard]] double best() const { return *std::min_element(seconds.begin(), seconds.end()); }
+    [[nodiscard]] double mean() const {
+        double sum = 0;
+        for (auto s: seconds) {
+            sum += s;
+        }
+        return sum / static_cast<double>(seconds.size());
+    }
+};
+
+/**
+ * @brief Creates fan_out subdirectories per level down to depth, and files files in every directory
+ *
+ * @returns The number of files created
+*/
+static size_t generate(const std::filesystem::path& root, const tree_shape& shape) {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    size_t created = 0;
+    std::function<void(const std::filesystem::path&, unsigned)> fill = [&](const std::filesystem::path& directory, unsigned level) {
+        std::filesystem::create_directories(directory);
+        for (unsigned i = 0; i < shape.files; i++) {
+            std::string name = std::to_string(i) + "_";
+            while (name.size() + 4 < shape.name_length) {
+                name += static_cast<char>(letter(random));
+            }
+            name += ".dat";
+            std::FILE* file = std::fopen((directory / name).c_str(), "w");
+            if (file == nullptr) {
+                throw std::filesystem::filesystem_error("cannot create file", directory / name,
+                                                        std::make_error_code(std::errc::io_error));
+            }
+            std::fclose(file);
+            created++;
+        }
+        if (level < shape.depth) {
+            for (unsigned i = 0; i < shape.fan_out; i++) {
+                fill(directory / ("dir" + std::to_string(i)), level + 1);
+            }
+        }
+    };
+    fill(root, 0);
+    return created;
+}
+
+/**
+ * @brief Runs and times a phase once
+*/
+static void measure(phase_result& result, const std::function<size_t()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    result.items = run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds.push_back(elapsed.count());
+}
+
+/**
+ * @brief Writes the rename file for the next rename: appends ".r" to every name, or removes it again
+*/
+static void edit(const std::filesystem::path& rename_txt) {
+    auto edited = std::filesystem::path(rename_txt).concat(".new");
+    {
+        manifest_reader in(rename_txt);
+        manifest_writer out(edited);
+        std::string_view line;
+        std::string name;
+        while (in.next(line)) {
+            name.assign(line);
+            if (name.ends_with(".r")) {
+                name.resize(name.size() - 2);
+            } else {
+                name += ".r";
+            }
+            out.write(name);
+        }
+        out.close();
+    }
+    std::filesystem::rename(edited, rename_txt);
+}
+
+/**
+ * @brief Reads the best time of the phases from a JSON file written by write_json
+*/
+static std::map<std::string, double> read_baseline(const std::filesystem::path& path,
+                                                   const std::vector<std::pair<std::string, phase_result>>& phases) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not read baseline " + path.string());
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    auto json = buffer.str();
+    std::map<std::string, double> baseline;
+    auto section = json.find("\"phases\"");
+    for (const auto &[name, result]: phases) {
+        auto phase = json.find("\"" + name + "\":", section);
+        auto best = phase == std::string::npos ? phase : json.find("\"best\":", phase);
+        if (section != std::string::npos && best != std::string::npos) {
+            baseline[name] = std::strtod(json.c_str() + best + 7, nullptr);
+        }
+    }
+    return baseline;
+}
+
+static void write_json(std::ostream& out, const tree_shape& shape, unsigned threads, size_t files,
+                       const std::vector<std::pair<std::string, phase_result>>& phases) {
+    out << std::setprecision(6) << std::fixed;
+    out << "{\n";
+    out << "  \"tree\": {\"fan_out\": " << shape.fan_out << ", \"depth\": " << shape.depth
+        << ", \"files_per_directory\": " << shape.files << ", \"name_length\": " << shape.name_length
+        << ", \"files\": " << files << "},\n";
+    out << "  \"threads\": " << threads << ",\n";
+    out << "  \"phases\": {\n";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const auto &[name, result] = phases[i];
+        out << "    \"" << name << "\": {\"items\": " << result.items << ", \"best\": " << result.best()
+            << ", \"mean\": " << result.mean() << ", \"items_per_second\": " << result.items / result.best() << "}"
+            << (i + 1 < phases.size() ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    littlesmith::arguments arguments;
+    arguments.setDescription("Measures scan, rename, manifest parsing and hashing on a synthetic tree");
+    arguments.defineValue("path", "p", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("path", "Where the tree is generated (removed afterwards). If omitted, /dev/shm or the temp directory is used");
+    arguments.defineValue("fan-out", "f", littlesmith::argument_type::INT, "4", true);
+    arguments.addDescription("fan-out", "The number of subdirectories of every directory");
+    arguments.defineValue("depth", "d", littlesmith::argument_type::INT, "4", true);
+    arguments.addDescription("depth", "The number of directory levels below the root");
+    arguments.defineValue("files", "n", littlesmith::argument_type::INT, "100", true);
+    arguments.addDescription("files", "The number of files in every directory");
+    arguments.defineValue("name-length", "l", littlesmith::argument_type::INT, "24", true);
+    arguments.addDescription("name-length", "The length of the file names");
+    arguments.defineValue("threads", "t", littlesmith::argument_type::INT, "1", true);
+    arguments.addDescription("threads", "The number of threads for scan and rename");
+    arguments.defineValue("repeat", "x", littlesmith::argument_type::INT, "3", true);
+    arguments.addDescription("repeat", "How often every phase is measured, the best run counts");
+    arguments.defineValue("output", "o", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("output", "Write the results as JSON to this file");
+    arguments.defineValue("baseline", "b", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("baseline", "Compare against the JSON results of an earlier run, fail if a phase got slower");
+    arguments.defineValue("tolerance", "T", littlesmith::argument_type::FLOAT, "10", true);
+    arguments.addDescription("tolerance", "How many percent slower than the baseline a phase may be");
+    if (!arguments.parse(argc, argv)) {
+        return -1;
+    }
+    arguments.printHeader();
+    tree_shape shape{static_cast<unsigned>(arguments.getValue<int>("fan-out")),
+                     static_cast<unsigned>(arguments.getValue<int>("depth")),
+                     static_cast<unsigned>(arguments.getValue<int>("files")),
+                     static_cast<unsigned>(std::max(arguments.getValue<int>("name-length"), 8))};
+    auto threads = static_cast<unsigned>(std::max(arguments.getValue<int>("threads"), 1));
+    auto repeat = std::max(arguments.getValue<int>("repeat"), 1);
+    std::filesystem::path root = arguments.getValue<std::string>("path");
+    if (root.empty()) {
+        root = std::filesystem::is_directory("/dev/shm") ? std::filesystem::path("/dev/shm")
+                                                         : std::filesystem::temp_directory_path();
+    }
+    root /= "multirenamer_bench_tree";
+
+    try {
+        std::filesystem::remove_all(root);
+        std::cout << "Generating " << root.string() << " ..." << std::endl;
+        auto files = generate(root, shape);
+        auto rename_txt = root / "multirenamer.txt";
+
+        phase_result scan, parse, hash, rename;
+        for (int run = 0; run < repeat; run++) {
+            multirenamer renamer(root);
+            scan_options scanOptions;
+            scanOptions.recursive = true;
+            scanOptions.threads = threads;
+            measure(scan, [&] {
+                renamer.scan(scanOptions);
+                return files;
+            });
+            measure(parse, [&] {
+                manifest_reader reader(rename_txt);
+                std::string_view line;
+                size_t lines = 0;
+                while (reader.next(line)) {
+                    lines++;
+                }
+                return lines;
+            });
+            std::vector<std::string> paths;
+            {
+                manifest_reader reader(rename_txt);
+                std::string_view line;
+                while (reader.next(line)) {
+                    paths.emplace_back(line);
+                }
+            }
+            measure(hash, [&] {
+                size_t hashed = 0;
+                for (const auto &path: paths) {
+                    hashed += littlesmith::SHA256::hashString(path).size() > 0;
+                }
+                return hashed;
+            });
+            edit(rename_txt);
+            rename_options renameOptions;
+            renameOptions.threads = threads;
+            measure(rename, [&] {
+                renamer.rename(renameOptions);
+                return files;
+            });
+            if (renamer.error()) {
+                throw std::runtime_error("Some renames failed, see " + (root / "multirenamer_error.log").string());
+            }
+            std::filesystem::remove(root / "multirenamer_renamed.txt");
+        }
+        std::filesystem::remove_all(root);
+
+        std::vector<std::pair<std::string, phase_result>> phases{
+                {"scan", scan}, {"parse", parse}, {"hash_string", hash}, {"rename", rename}};
+        for (const auto &[name, result]: phases) {
+            std::cout << std::left << std::setw(12) << name
+                      << std::right << std::setw(10) << result.items << " items "
+                      << std::setw(10) << std::fixed << std::setprecision(4) << result.best() << " s best "
+                      << std::setw(10) << result.mean() << " s mean "
+                      << std::setw(14) << std::setprecision(0) << result.items / result.best() << " items/s" << std::endl;
+        }
+        auto output = arguments.getValue<std::string>("output");
+        if (!output.empty()) {
+            std::ofstream out(output);
+            write_json(out, shape, threads, files, phases);
+        }
+        auto baseline_path = arguments.getValue<std::string>("baseline");
+        if (!baseline_path.empty()) {
+            auto baseline = read_baseline(baseline_path, phases);
+            auto tolerance = 1.0 + arguments.getValue<float>("tolerance") / 100.0;
+            bool regression = false;
+            for (const auto &[name, result]: phases) {
+                auto it = baseline.find(name);
+                if (it == baseline.end() || it->second <= 0) {
+                    continue;
+                }
+                auto ratio = result.best() / it->second;
+                bool slower = ratio > tolerance;
+                regression = regression || slower;
+                std::cout << std::left << std::setw(12) << name << std::right << std::setw(8) << std::setprecision(1)
+                          << (ratio - 1.0) * 100.0 << " % vs. baseline" << (slower ? "  REGRESSION" : "") << std::endl;
+            }
+            if (regression) {
+                return 1;
+            }
+        }
+    } catch (std::exception& ex) {
+        std::cerr << "Benchmark failed:" << std::endl << ex.what() << std::endl;
+        std::error_code error;
+        std::filesystem::remove_all(root, error);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+* @file pattern_bench.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Measures name_pattern against std::regex_replace.
+ *
+ * Applies a set of typical rename substitutions to synthetic paths, with
+ * std::regex_replace, with name_pattern on one thread and with
+ * name_pattern on all threads. Both engines must produce the same names.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <vector>
+#include <littlesmith/util/Arguments.h>
+#include <littlesmith/util/Parallel.h>
+#include "../name_pattern.h"
+
+/** @brief Names per batch in the parallel run */
+static const size_t BATCH_SIZE = 1024;
+
+/**
+ * @brief A substitution in the syntax of both engines
+*/
+struct substitution {
+    std::string regex;
+    std::string replacement;
+    bool global;
+    bool ignore_case;
+};
+
+/**
+ * @brief Creates paths like /data/archive/2019/holiday/IMG_1234.JPG
+*/
+static std::vector<std::string> generate(size_t count) {
+    std::mt19937 random(42);
+    const char* roots[] = {"/data/archive", "/home/user/pictures", "/srv/share/scans"};
+    const char* folders[] = {"holiday", "family", "work_2020", "misc", "Camera Uploads"};
+    const char* prefixes[] = {"IMG_", "DSC", "scan_", "report-", "photo "};
+    const char* extensions[] = {".JPG", ".jpg", ".png", ".pdf", ".txt"};
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        paths.push_back(std::string(roots[random() % 3]) + "/" + std::to_string(2010 + random() % 15) + "/" +
+                        folders[random() % 5] + "/" + prefixes[random() % 5] +
+                        std::to_string(random() % 100000) + extensions[random() % 5]);
+    }
+    return paths;
+}
+
+/**
+ * @brief Runs one measurement and prints the result
+*/
+static double measure(const std::string& name, size_t count, int repeat, const std::function<void()>& run) {
+    double best = 0;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    std::cout << "  " << std::left << std::setw(22) << name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(4) << best << " s "
+              << std::setw(14) << std::setprecision(0) << count / best << " names/s" << std::endl;
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    littlesmith::arguments arguments;
+    arguments.setDescription("Measures the substitutions of --pattern against std::regex_replace");
+    arguments.defineValue("count", "n", littlesmith::argument_type::INT, "200000", true);
+    arguments.addDescription("count", "The number of paths");
+    arguments.defineValue("threads", "t", littlesmith::argument_type::INT, "4", true);
+    arguments.addDescription("threads", "The number of threads for the parallel run");
+    arguments.defineValue("repeat", "x", littlesmith::argument_type::INT, "3", true);
+    arguments.addDescription("repeat", "How often every measurement is repeated, the best run counts");
+    if (!arguments.parse(argc, argv)) {
+        return -1;
+    }
+    arguments.printHeader();
+    auto count = static_cast<size_t>(std::max(arguments.getValue<int>("count"), 1));
+    auto threads = static_cast<unsigned>(std::max(arguments.getValue<int>("threads"), 1));
+    auto repeat = std::max(arguments.getValue<int>("repeat"), 1);
+    auto paths = generate(count);
+
+    std::vector<substitution> substitutions{
+            {R"(\.JPG$)", ".jpg", false, false},
+            {R"(IMG_([0-9]+))", "photo-\\1", false, false},
+            {R"(/([0-9]{4})/([a-z_0-9]+)/)", "/\\2/\\1/", false, false},
+            {R"([ _-])", ".", true, false},
+            {R"((dsc|img)_?(\d+)\.(jpg|png)$)", "\\2.\\3", false, true},
+            {R"(^/home/user/(.*)$)", "/archive/&", false, false},
+    };
+    int result = 0;
+    for (const auto &s: substitutions) {
+        std::string expression = "s~" + s.regex + "~" + s.replacement + "~" + (s.global ? "g" : "") +
+                                 (s.ignore_case ? "i" : "");
+        std::cout << expression << std::endl;
+        std::regex regex(s.regex, s.ignore_case ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+        auto flags = std::regex_constants::format_sed |
+                     (s.global ? std::regex_constants::format_default : std::regex_constants::format_first_only);
+        name_pattern pattern(expression);
+        std::vector<std::string> expected(count), actual(count);
+        auto reference = measure("std::regex_replace", count, repeat, [&] {
+            for (size_t i = 0; i < count; i++) {
+                expected[i] = std::regex_replace(paths[i], regex, s.replacement, flags);
+            }
+        });
+        auto single = measure("name_pattern", count, repeat, [&] {
+            name_pattern::matcher matcher(pattern);
+            for (size_t i = 0; i < count; i++) {
+                matcher.substitute(paths[i], actual[i]);
+            }
+        });
+        auto parallel = measure("name_pattern " + std::to_string(threads) + " threads", count, repeat, [&] {
+            // batches like the directories of a scan
+            littlesmith::parallel_for((count + BATCH_SIZE - 1) / BATCH_SIZE, threads, [&](size_t batch, unsigned) {
+                auto first = batch * BATCH_SIZE;
+                auto last = std::min(first + BATCH_SIZE, count);
+                std::vector<std::string> names(paths.begin() + first, paths.begin() + last), results;
+                pattern.substitute(names, results);
+                std::move(results.begin(), results.end(), actual.begin() + first);
+            });
+        });
+        std::cout << "  speedup " << std::setprecision(1) << reference / single << "x, "
+                  << reference / parallel << "x with " << threads << " threads" << std::endl;
+        for (size_t i = 0; i < count; i++) {
+            if (expected[i] != actual[i]) {
+                std::cout << "  MISMATCH for " << paths[i] << ": " << actual[i] << " instead of " << expected[i] << std::endl;
+                result = 1;
+                break;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,116 @@
+/**
+* @file sha256_bench.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Measures the throughput of the SHA-256 kernels.
+ *
+ * Hashes one large buffer with every single buffer kernel, and many small
+ * messages with every kernel including the AVX2 multi buffer one. Kernels
+ * the CPU does not support are skipped. All kernels must produce the same
+ * digests.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <littlesmith/crypto/SHA256.h>
+#include <littlesmith/util/Arguments.h>
+
+using littlesmith::SHA256;
+using littlesmith::sha256_kernel;
+
+static const char* kernel_name(sha256_kernel kernel) {
+    switch (kernel) {
+        case sha256_kernel::scalar:
+            return "scalar";
+        case sha256_kernel::sha_ni:
+            return "sha_ni";
+        case sha256_kernel::avx2_multi_buffer:
+            return "avx2 x8";
+    }
+    return "?";
+}
+
+/**
+ * @brief Runs one measurement and prints the result
+*/
+static void measure(const std::string& name, uint64_t bytes, int repeat, const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) {
+        run();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(28) << name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(3) << elapsed.count() << " s "
+              << std::setw(8) << std::setprecision(2) << (bytes * repeat / 1e9) / elapsed.count() << " GB/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    littlesmith::arguments arguments;
+    arguments.setDescription("Measures how fast the SHA-256 kernels hash");
+    arguments.defineValue("size", "n", littlesmith::argument_type::INT, "256", true);
+    arguments.addDescription("size", "The size of the large buffer in MiB");
+    arguments.defineValue("messages", "m", littlesmith::argument_type::INT, "200000", true);
+    arguments.addDescription("messages", "The number of small messages");
+    arguments.defineValue("message-size", "l", littlesmith::argument_type::INT, "1024", true);
+    arguments.addDescription("message-size", "The size of every small message in bytes");
+    arguments.defineValue("repeat", "x", littlesmith::argument_type::INT, "3", true);
+    arguments.addDescription("repeat", "How often every measurement is repeated");
+    if (!arguments.parse(argc, argv)) {
+        return -1;
+    }
+    arguments.printHeader();
+    auto size = static_cast<size_t>(arguments.getValue<long>("size")) << 20;
+    auto messages = static_cast<size_t>(arguments.getValue<long>("messages"));
+    auto message_size = static_cast<size_t>(arguments.getValue<long>("message-size"));
+    auto repeat = arguments.getValue<int>("repeat");
+
+    std::vector<uint8_t> buffer(size);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+    }
+    std::vector<const uint8_t*> pointers(messages);
+    std::vector<size_t> lengths(messages, message_size);
+    for (size_t i = 0; i < messages; i++) {
+        pointers[i] = buffer.data() + (i * message_size) % (buffer.size() - message_size + 1);
+    }
+
+    bool ok = true;
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> reference_many;
+    for (auto kernel: {sha256_kernel::scalar, sha256_kernel::sha_ni, sha256_kernel::avx2_multi_buffer}) {
+        if (!SHA256::supported(kernel)) {
+            std::cout << std::left << std::setw(28) << kernel_name(kernel) << "not supported" << std::endl;
+            continue;
+        }
+        if (kernel != sha256_kernel::avx2_multi_buffer) {
+            std::vector<uint8_t> digest;
+            measure(std::string(kernel_name(kernel)) + " " + std::to_string(size >> 20) + " MiB", size, repeat, [&] {
+                SHA256 ctx{};
+                ctx.init(kernel);
+                ctx.update(buffer.data(), buffer.size());
+                digest = ctx.final();
+            });
+            if (reference.empty()) {
+                reference = digest;
+            }
+            ok = ok && digest == reference;
+        }
+        std::vector<uint8_t> digests(messages * SHA256::DIGEST_SIZE);
+        measure(std::string(kernel_name(kernel)) + " " + std::to_string(messages) + " x " +
+                std::to_string(message_size) + " B", messages * message_size, repeat, [&] {
+            SHA256::hashMany(pointers.data(), lengths.data(), messages, digests.data(), kernel);
+        });
+        if (reference_many.empty()) {
+            reference_many = digests;
+        }
+        ok = ok && digests == reference_many;
+    }
+    if (!ok) {
+        std::cerr << "The kernels disagree!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
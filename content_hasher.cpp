@@ -0,0 +1,206 @@
+/**
+* @file content_hasher.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the content_hasher class.
+ *
+ * Hashes the content of the scanned files on a pool of threads.
+ */
+
+#include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <littlesmith/crypto/SHA256.h>
+#include <littlesmith/util/Compat.h>
+#include "content_hasher.h"
+#include "run_stats.h"
+
+namespace {
+    /** @brief Number of queued files per thread before submit() blocks */
+    const size_t QUEUED_PER_THREAD = 256;
+
+    const size_t HEX_DIGEST_SIZE = 2 * littlesmith::SHA256::DIGEST_SIZE;
+
+    void to_hex(const uint8_t* digest, std::string& hex) {
+        static const char digits[] = "0123456789abcdef";
+        hex.resize(HEX_DIGEST_SIZE);
+        for (size_t i = 0; i < littlesmith::SHA256::DIGEST_SIZE; i++) {
+            hex[2 * i] = digits[digest[i] >> 4];
+            hex[2 * i + 1] = digits[digest[i] & 0x0f];
+        }
+    }
+}
+
+content_hasher::content_hasher(unsigned threads, batch_callback callback, hash_cache *cache) :
+    _callback(std::move(callback)), _cache(cache), _capacity(QUEUED_PER_THREAD * (threads == 0 ? 1 : threads)) {
+    for (unsigned i = 0; i < (threads == 0 ? 1 : threads); i++) {
+        _threads.emplace_back(&content_hasher::run, this);
+    }
+}
+
+content_hasher::~content_hasher() {
+    try {
+        finish();
+    } catch (...) {
+        // finish() was not called, nobody is interested in the error anymore
+    }
+}
+
+void content_hasher::submit(std::vector<std::string> files) {
+    if (files.empty()) {
+        return;
+    }
+    auto owner = std::make_shared<batch>();
+    owner->files = std::move(files);
+    owner->digests.resize(owner->files.size());
+    owner->remaining = owner->files.size();
+    std::unique_lock lock(_mutex);
+    _space.wait(lock, [this] { return _jobs.size() < _capacity || _error; });
+    if (_error) {
+        // finish() reports it
+        return;
+    }
+    for (size_t i = 0; i < owner->files.size(); i++) {
+        _jobs.push_back({owner, i});
+    }
+    lock.unlock();
+    _work.notify_all();
+}
+
+void content_hasher::finish() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _work.notify_all();
+    for (auto &thread: _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    if (_error) {
+        std::rethrow_exception(std::exchange(_error, nullptr));
+    }
+}
+
+void content_hasher::run() {
+    std::vector<uint8_t> buffer;
+    while (true) {
+        job next;
+        {
+            std::unique_lock lock(_mutex);
+            _work.wait(lock, [this] { return !_jobs.empty() || _stop; });
+            if (_jobs.empty()) {
+                return;
+            }
+            next = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        _space.notify_one();
+        auto &owner = *next.owner;
+        if (!hash_file(owner.files[next.index], buffer, owner.digests[next.index], _cache)) {
+            owner.digests[next.index].clear();
+        }
+        if (--owner.remaining == 0) {
+            try {
+                _callback(owner.files, owner.digests);
+            } catch (...) {
+                std::lock_guard lock(_mutex);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+                _jobs.clear();
+                _space.notify_all();
+            }
+        }
+    }
+}
+
+bool content_hasher::hash_file(const std::string &path, std::vector<uint8_t> &buffer, std::string &digest,
+                               hash_cache *cache) {
+    uint8_t result[littlesmith::SHA256::DIGEST_SIZE];
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    auto key_of = [](const struct stat &st) {
+        return file_key{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino), static_cast<uint64_t>(st.st_size),
+                        static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+    };
+    auto key = key_of(st);
+    if (cache != nullptr && cache->lookup(key, result)) {
+        ::close(fd);
+        to_hex(result, digest);
+        return true;
+    }
+    buffer.resize(BUFFER_SIZE);
+    littlesmith::SHA256 sha{};
+    sha.init();
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    off_t offset = 0;
+    while (true) {
+        auto n = ::pread(fd, buffer.data(), buffer.size(), offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            ::close(fd);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        sha.update(buffer.data(), static_cast<size_t>(n));
+        offset += n;
+    }
+    run_stats::instance().bytes_read += static_cast<uint64_t>(offset);
+    sha.final(result);
+    // a file modified while it was read must not end up in the cache
+    if (cache != nullptr && ::fstat(fd, &st) == 0 && key_of(st) == key) {
+        cache->insert(key, result);
+    }
+    ::close(fd);
+#else
+    UNREFERENCED_PARAMETER(cache);
+    buffer.resize(BUFFER_SIZE);
+    littlesmith::SHA256 sha{};
+    sha.init();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    while (in) {
+        in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        sha.update(buffer.data(), static_cast<size_t>(in.gcount()));
+    }
+    if (in.bad()) {
+        return false;
+    }
+    sha.final(result);
+#endif
+    to_hex(result, digest);
+    return true;
+}
+
+std::string_view strip_hash_column(std::string_view line) {
+    if (line.size() <= HEX_DIGEST_SIZE || line[line.size() - HEX_DIGEST_SIZE - 1] != '\t') {
+        return line;
+    }
+    auto column = line.substr(line.size() - HEX_DIGEST_SIZE);
+    for (auto c: column) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return line;
+        }
+    }
+    return line.substr(0, line.size() - HEX_DIGEST_SIZE - 1);
+}
@@ -0,0 +1,134 @@
+/**
+* @file content_hasher.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the content_hasher class.
+ *
+ * Hashes the content of the scanned files on a pool of threads.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "hash_cache.h"
+
+/**
+ * @brief Computes the SHA-256 of files on a thread pool
+ *
+ * The files are submitted in batches (one batch per directory). Every file
+ * is a job of its own, so the files of one batch are read in parallel and
+ * as many files as there are threads are in flight at any time. When the
+ * last file of a batch is done, the callback receives the batch together
+ * with the digests, on the thread that hashed that file.
+ *
+ * Files are read with pread into a large buffer per thread. Files that are
+ * not regular or cannot be read get an empty digest. With a hash_cache,
+ * files whose device, inode, size and mtime are in the cache are not read
+ * at all.
+*/
+class content_hasher {
+public:
+    /**
+     * @brief Receives a hashed batch
+     *
+     * Calls from different threads may run concurrently.
+     *
+     * @param files The files of the batch
+     * @param digests The digest of every file as 64 hex digits, empty if the file could not be hashed
+    */
+    using batch_callback = std::function<void(std::vector<std::string>& files, const std::vector<std::string>& digests)>;
+
+    /** @brief Size of the read buffer of every thread */
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+private:
+    struct batch {
+        std::vector<std::string> files;
+        std::vector<std::string> digests;
+        std::atomic<size_t> remaining;
+    };
+
+    struct job {
+        std::shared_ptr<batch> owner;
+        size_t index;
+    };
+
+    batch_callback _callback;
+    hash_cache* _cache;
+    size_t _capacity;
+    std::mutex _mutex;
+    std::condition_variable _work;
+    std::condition_variable _space;
+    std::deque<job> _jobs;
+    bool _stop{false};
+    std::exception_ptr _error;
+    std::vector<std::thread> _threads;
+
+    void run();
+
+public:
+    /**
+     * @brief Constructor for the content_hasher, starts the threads
+     *
+     * @param threads The number of files hashed at the same time
+     * @param callback Receives the hashed batches
+     * @param cache The cache of digests from earlier runs, nullptr for none
+    */
+    content_hasher(unsigned threads, batch_callback callback, hash_cache* cache = nullptr);
+    content_hasher(const content_hasher&) = delete;
+    content_hasher& operator=(const content_hasher&) = delete;
+    ~content_hasher();
+
+    /**
+     * @brief Queues a batch of files
+     *
+     * Blocks while too many files are waiting, so the walk cannot run away
+     * from the hashing.
+     *
+     * @param files The full paths of the files
+    */
+    void submit(std::vector<std::string> files);
+
+    /**
+     * @brief Waits until all batches are hashed and stops the threads
+     *
+     * Rethrows the first exception thrown by the callback.
+    */
+    void finish();
+
+    /**
+     * @brief Hashes a single file
+     *
+     * @param path The file
+     * @param buffer The read buffer, resized to BUFFER_SIZE if needed
+     * @param digest Receives the digest as 64 hex digits
+     * @param cache The cache of digests from earlier runs, nullptr for none
+     * @returns false if the file is not a regular file or could not be read
+    */
+    static bool hash_file(const std::string& path, std::vector<uint8_t>& buffer, std::string& digest,
+                          hash_cache* cache = nullptr);
+};
+
+/**
+ * @brief Removes the digest column from a line of the rename file
+ *
+ * With --hash, scan appends a TAB and the 64 hex digits of the digest to
+ * every line of the rename file. The column is ignored when renaming, but
+ * only if the scan wrote it: a name may end like a digest column itself.
+ *
+ * @param line A line of the rename file
+ * @returns The line without a trailing digest column
+*/
+std::string_view strip_hash_column(std::string_view line);
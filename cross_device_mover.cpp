@@ -0,0 +1,371 @@
+/**
+* @file cross_device_mover.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the cross_device_mover class.
+ *
+ * Moves files to another filesystem, where rename is not possible.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/xattr.h>
+#endif
+
+#include <littlesmith/util/Parallel.h>
+#include "cross_device_mover.h"
+#include "directory_cache.h"
+#include "run_stats.h"
+
+namespace {
+    const size_t COPY_BUFFER_SIZE = 1024 * 1024;
+    /** @brief Largest chunk handed to copy_file_range or sendfile at once */
+    const size_t COPY_CHUNK_SIZE = 1024 * 1024 * 1024;
+
+    [[noreturn]] void fail(const rename_operation &operation, int error) {
+        throw std::filesystem::filesystem_error("cannot move across filesystems", operation.from, operation.to,
+                                                std::error_code(error, std::system_category()));
+    }
+
+#ifdef __linux__
+    /**
+     * @brief Closes a file descriptor when leaving the scope
+    */
+    struct descriptor {
+        int fd{-1};
+
+        ~descriptor() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+
+    /**
+     * @brief Whether the error only means that this way of copying is not possible here
+    */
+    bool unsupported(int error) {
+        return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == ENOTTY ||
+               error == EBADF;
+    }
+
+    /**
+     * @returns 0 or the errno of the failure
+    */
+    int copy_data(int in, int out, uint64_t size) {
+        // a reflink shares the blocks, possible if both names are on the same filesystem
+        if (::ioctl(out, FICLONE, in) == 0) {
+            return 0;
+        }
+        uint64_t done = 0;
+        while (done < size) {
+            auto n = ::copy_file_range(in, nullptr, out, nullptr, std::min<uint64_t>(size - done, COPY_CHUNK_SIZE), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && done == 0 && unsupported(errno)) {
+                break;
+            }
+            if (n < 0) {
+                return errno;
+            }
+            if (n == 0) {
+                return done == size ? 0 : EIO;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        if (done == size) {
+            return 0;
+        }
+        off_t offset = 0;
+        while (done < size) {
+            auto n = ::sendfile(out, in, &offset, std::min<uint64_t>(size - done, COPY_CHUNK_SIZE));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && done == 0 && unsupported(errno)) {
+                break;
+            }
+            if (n < 0) {
+                return errno;
+            }
+            if (n == 0) {
+                return EIO;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        if (done == size) {
+            return 0;
+        }
+        thread_local std::vector<char> buffer(COPY_BUFFER_SIZE);
+        while (done < size) {
+            auto n = ::pread(in, buffer.data(), std::min<uint64_t>(size - done, buffer.size()), static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return n < 0 ? errno : EIO;
+            }
+            for (ssize_t written = 0; written < n;) {
+                auto w = ::pwrite(out, buffer.data() + written, static_cast<size_t>(n - written),
+                                  static_cast<off_t>(done) + written);
+                if (w < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (w < 0) {
+                    return errno;
+                }
+                written += w;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        return 0;
+    }
+
+    /**
+     * @returns 0 or the errno of the failure
+    */
+    int copy_metadata(int in, int out, const struct stat &st) {
+        // extended attributes the filesystem or the user cannot set are left out
+        auto size = ::flistxattr(in, nullptr, 0);
+        if (size > 0) {
+            std::vector<char> names(static_cast<size_t>(size));
+            size = ::flistxattr(in, names.data(), names.size());
+            std::vector<char> value;
+            for (ssize_t offset = 0; offset < size;) {
+                const char *name = names.data() + offset;
+                offset += static_cast<ssize_t>(std::char_traits<char>::length(name)) + 1;
+                auto length = ::fgetxattr(in, name, nullptr, 0);
+                if (length < 0) {
+                    continue;
+                }
+                value.resize(static_cast<size_t>(length));
+                length = ::fgetxattr(in, name, value.data(), value.size());
+                if (length >= 0) {
+                    ::fsetxattr(out, name, value.data(), static_cast<size_t>(length), 0);
+                }
+            }
+        }
+        // only root may give a file away, the owner is kept where possible
+        if (::fchown(out, st.st_uid, st.st_gid) != 0 && errno != EPERM) {
+            return errno;
+        }
+        if (::fchmod(out, st.st_mode & 07777) != 0) {
+            return errno;
+        }
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        if (::futimens(out, times) != 0) {
+            return errno;
+        }
+        return 0;
+    }
+
+    void move_link(const rename_operation &operation, const struct stat &st) {
+        std::string from(operation.from);
+        std::string to(operation.to);
+        std::vector<char> target(static_cast<size_t>(st.st_size) + 1);
+        auto length = ::readlink(from.c_str(), target.data(), target.size());
+        if (length < 0 || static_cast<size_t>(length) >= target.size()) {
+            fail(operation, length < 0 ? errno : EIO);
+        }
+        target[static_cast<size_t>(length)] = 0;
+        // symlink never replaces an existing name
+        if (::symlink(target.data(), to.c_str()) != 0) {
+            fail(operation, errno);
+        }
+        ::fchownat(AT_FDCWD, to.c_str(), st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW);
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        ::utimensat(AT_FDCWD, to.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        descriptor directory{::open(std::string(split_path(operation.to).first).c_str(),
+                                    O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (directory.fd >= 0) {
+            ::fsync(directory.fd);
+        }
+        if (::unlink(from.c_str()) != 0) {
+            fail(operation, errno);
+        }
+    }
+#endif
+}
+
+cross_device_mover::cross_device_mover(unsigned threads, uint64_t budget) :
+    _threads(threads == 0 ? 1 : threads), _budget(budget == 0 ? 1 : budget) {
+}
+
+uint64_t cross_device_mover::acquire(uint64_t bytes) {
+    bytes = std::min(bytes, _budget);
+    std::unique_lock lock(_mutex);
+    _cv.wait(lock, [&] { return _in_flight + bytes <= _budget; });
+    _in_flight += bytes;
+    return bytes;
+}
+
+void cross_device_mover::release(uint64_t bytes) {
+    {
+        std::lock_guard lock(_mutex);
+        _in_flight -= bytes;
+    }
+    _cv.notify_all();
+}
+
+void cross_device_mover::move(const std::vector<rename_operation> &operations, std::vector<rename_failure> &failures,
+                              const rename_executor::completion_callback &callback) {
+    std::vector<size_t> moves;
+    for (size_t i = 0; i < failures.size(); i++) {
+        if (failures[i].error == EXDEV) {
+            moves.push_back(i);
+        }
+    }
+    if (moves.empty()) {
+        return;
+    }
+    // one byte per failure, the threads must not share bits of a word
+    std::vector<char> moved(failures.size(), 0);
+    littlesmith::parallel_for(moves.size(), _threads, [&](size_t m, unsigned) {
+        auto &failure = failures[moves[m]];
+        try {
+            move(operations[failure.operation]);
+            moved[moves[m]] = 1;
+        } catch (std::filesystem::filesystem_error &ex) {
+            failure.message = ex.what();
+            failure.error = ex.code().value();
+        }
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < failures.size(); i++) {
+        if (moved[i]) {
+            if (callback) {
+                callback(failures[i].operation);
+            }
+            run_stats::instance().cross_device_moves++;
+        } else {
+            failures[kept++] = std::move(failures[i]);
+        }
+    }
+    failures.resize(kept);
+}
+
+void cross_device_mover::move(const rename_operation &operation) {
+#ifdef __linux__
+    std::string from(operation.from);
+    struct stat st{};
+    if (::lstat(from.c_str(), &st) != 0) {
+        fail(operation, errno);
+    }
+    if (S_ISLNK(st.st_mode)) {
+        move_link(operation, st);
+        return;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fail(operation, EXDEV);
+    }
+    auto size = static_cast<uint64_t>(st.st_size);
+    auto reserved = acquire(size);
+    int error = 0;
+    std::string temporary;
+    auto [newDirectory, newName] = split_path(operation.to);
+    std::string name(newName);
+    descriptor directory{::open(newDirectory.empty() ? "." : std::string(newDirectory).c_str(),
+                                O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    descriptor in{::open(from.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC)};
+    descriptor out;
+    if (directory.fd < 0 || in.fd < 0) {
+        error = errno;
+    } else {
+        // unnamed until the copy is complete, so a crash leaves nothing behind
+        out.fd = ::openat(directory.fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0600);
+        if (out.fd < 0 && (errno == EOPNOTSUPP || errno == EISDIR || errno == EINVAL)) {
+            temporary = name + ".multirenamer~copy";
+            out.fd = ::openat(directory.fd, temporary.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600);
+        }
+        if (out.fd < 0) {
+            error = errno;
+            temporary.clear();
+        }
+    }
+    if (error == 0) {
+        error = copy_data(in.fd, out.fd, size);
+    }
+    if (error == 0) {
+        error = copy_metadata(in.fd, out.fd, st);
+    }
+    if (error == 0 && ::fsync(out.fd) != 0) {
+        error = errno;
+    }
+    if (error == 0) {
+        // the copy is only used if it has all the data and the source did not change meanwhile
+        struct stat source{};
+        struct stat copy{};
+        if (::fstat(in.fd, &source) != 0 || ::fstat(out.fd, &copy) != 0) {
+            error = errno;
+        } else if (copy.st_size != st.st_size) {
+            error = EIO;
+        } else if (source.st_ino != st.st_ino || source.st_size != st.st_size ||
+                   source.st_mtim.tv_sec != st.st_mtim.tv_sec || source.st_mtim.tv_nsec != st.st_mtim.tv_nsec) {
+            error = EBUSY;
+        }
+    }
+    if (error == 0) {
+        // neither way replaces an existing name
+        if (temporary.empty()) {
+            auto proc = "/proc/self/fd/" + std::to_string(out.fd);
+            if (::linkat(AT_FDCWD, proc.c_str(), directory.fd, name.c_str(), AT_SYMLINK_FOLLOW) != 0) {
+                error = errno;
+            }
+        } else if (::renameat2(directory.fd, temporary.c_str(), directory.fd, name.c_str(), RENAME_NOREPLACE) != 0) {
+            error = errno;
+        } else {
+            temporary.clear();
+        }
+    }
+    if (error == 0 && ::fsync(directory.fd) != 0) {
+        error = errno;
+    }
+    if (!temporary.empty()) {
+        ::unlinkat(directory.fd, temporary.c_str(), 0);
+    }
+    release(reserved);
+    if (error == 0 && ::unlink(from.c_str()) != 0) {
+        error = errno;
+    }
+    if (error != 0) {
+        fail(operation, error);
+    }
+    run_stats::instance().bytes_copied += size;
+#else
+    std::error_code error;
+    auto status = std::filesystem::symlink_status(operation.from, error);
+    if (error || !std::filesystem::is_regular_file(status)) {
+        fail(operation, error ? error.value() : EXDEV);
+    }
+    auto size = static_cast<uint64_t>(std::filesystem::file_size(operation.from, error));
+    auto reserved = acquire(size);
+    auto modified = std::filesystem::last_write_time(operation.from, error);
+    if (!error) {
+        std::filesystem::copy_file(operation.from, operation.to, std::filesystem::copy_options::none, error);
+    }
+    if (!error) {
+        std::filesystem::last_write_time(operation.to, modified, error);
+    }
+    release(reserved);
+    if (!error) {
+        std::filesystem::remove(operation.from, error);
+    }
+    if (error) {
+        fail(operation, error.value());
+    }
+    run_stats::instance().bytes_copied += size;
+#endif
+}
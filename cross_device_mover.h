@@ -0,0 +1,73 @@
+/**
+* @file cross_device_mover.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the cross_device_mover class.
+ *
+ * Moves files to another filesystem, where rename is not possible.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "rename_executor.h"
+
+/**
+ * @brief Finishes the renames that failed with EXDEV by copying the file and removing the source
+ *
+ * The data is copied by the kernel where possible: a reflink (FICLONE) if
+ * both names are on the same filesystem mounted twice, otherwise
+ * copy_file_range, then sendfile, and read/write as last resort. The copy
+ * gets the mode, owner (if permitted), timestamps and extended attributes
+ * of the source. It is written to an unnamed file (O_TMPFILE, or a
+ * temporary name where that is not supported) and synced, then checked
+ * against the source: same size, and the source was not modified while
+ * copying. Only then it is linked under the new name, which is never
+ * overwritten, the directory is synced and the source is removed. Symbolic
+ * links are recreated. Directories are not copied.
+ *
+ * Several files are copied at once by a pool of threads. The bytes being
+ * copied at a time are limited by a budget, a file larger than the budget
+ * is copied alone.
+*/
+class cross_device_mover {
+public:
+    /** @brief Default number of files copied at the same time */
+    static constexpr unsigned DEFAULT_THREADS = 8;
+    /** @brief Default number of bytes being copied at the same time */
+    static constexpr uint64_t DEFAULT_BUDGET = 256ULL * 1024 * 1024;
+
+private:
+    unsigned _threads;
+    uint64_t _budget;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    uint64_t _in_flight{0};
+
+    uint64_t acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+    void move(const rename_operation& operation);
+
+public:
+    /**
+     * @brief Constructor for the cross_device_mover
+     *
+     * @param threads The number of files copied at the same time
+     * @param budget The number of bytes being copied at the same time
+    */
+    explicit cross_device_mover(unsigned threads = DEFAULT_THREADS, uint64_t budget = DEFAULT_BUDGET);
+
+    /**
+     * @brief Moves the files of all operations that failed with EXDEV
+     *
+     * @param operations The plan
+     * @param failures The failed operations of the plan, the moved ones are removed, the others get the error of the copy
+     * @param callback Optional callback receiving every operation moved successfully
+    */
+    void move(const std::vector<rename_operation>& operations, std::vector<rename_failure>& failures,
+              const rename_executor::completion_callback& callback = nullptr);
+};
@@ -0,0 +1,86 @@
+/**
+* @file directory_cache.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the directory_cache class.
+ *
+ * Keeps directories open, so that operations can be issued relative to them.
+ */
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "directory_cache.h"
+
+namespace {
+    const size_t MIN_CAPACITY = 64;
+}
+
+std::pair<std::string_view, std::string_view> split_path(std::string_view path) {
+    while (path.size() > 1 && path.ends_with('/')) {
+        path.remove_suffix(1);
+    }
+    auto pos = path.rfind('/');
+    if (pos == std::string_view::npos) {
+        return {std::string_view(), path};
+    }
+    return {pos == 0 ? path.substr(0, 1) : path.substr(0, pos), path.substr(pos + 1)};
+}
+
+directory_cache::directory_cache(size_t capacity) : _capacity(capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity) {
+}
+
+directory_cache::directory_cache(directory_cache &&other) noexcept :
+    _capacity(other._capacity), _lru(std::move(other._lru)), _index(std::move(other._index)) {
+    other._lru.clear();
+    other._index.clear();
+}
+
+directory_cache::~directory_cache() {
+    clear();
+}
+
+void directory_cache::clear() {
+    for (auto &[path, fd]: _lru) {
+        ::close(fd);
+    }
+    _index.clear();
+    _lru.clear();
+}
+
+int directory_cache::open(std::string_view directory) {
+    if (directory.empty()) {
+        return AT_FDCWD;
+    }
+    auto it = _index.find(directory);
+    if (it != _index.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return it->second->second;
+    }
+    int fd;
+    auto [parent, name] = split_path(directory);
+    if (name.empty() || parent.empty() || parent == directory) {
+        // the root, or a relative name, is resolved directly
+        fd = ::open(std::string(directory).c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    } else {
+        int parent_fd = open(parent);
+        if (parent_fd < 0 && parent_fd != AT_FDCWD) {
+            return -1;
+        }
+        fd = ::openat(parent_fd, std::string(name).c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    if (_lru.size() >= _capacity) {
+        auto &last = _lru.back();
+        _index.erase(last.first);
+        ::close(last.second);
+        _lru.pop_back();
+    }
+    _lru.emplace_front(std::string(directory), fd);
+    _index.emplace(_lru.front().first, _lru.begin());
+    return fd;
+}
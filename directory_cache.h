@@ -0,0 +1,85 @@
+/**
+* @file directory_cache.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the directory_cache class.
+ *
+ * Keeps directories open, so that operations can be issued relative to them.
+ */
+
+#pragma once
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief LRU cache of open directory handles, keyed by path
+ *
+ * A directory that is not cached yet is opened relative to its (cached)
+ * parent, so every path component is only resolved once as long as it
+ * stays in the cache. The handles are O_PATH descriptors, meant to be used
+ * as dirfd argument of the *at system calls.
+ *
+ * The cache is not thread safe, every worker uses its own.
+*/
+class directory_cache {
+private:
+    using entry = std::pair<std::string, int>;
+
+    size_t _capacity;
+    std::list<entry> _lru;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> _index;
+
+public:
+    /**
+     * @brief Constructor for the directory_cache
+     *
+     * @param capacity The maximum number of open directories
+    */
+    explicit directory_cache(size_t capacity);
+    directory_cache(const directory_cache&) = delete;
+    directory_cache& operator=(const directory_cache&) = delete;
+    directory_cache(directory_cache&& other) noexcept;
+    ~directory_cache();
+
+    /**
+     * @brief Returns a handle for the directory, opening it if necessary
+     *
+     * The handle belongs to the cache and must not be closed. It stays
+     * valid until clear() is called or capacity - 1 other directories
+     * (including uncached ancestors) were opened after it, so two handles
+     * can be used together for paths of any realistic depth.
+     *
+     * @param directory The directory, "" stands for the current directory
+     * @returns The handle, or -1 with errno set
+    */
+    int open(std::string_view directory);
+
+    /**
+     * @brief Closes all handles
+    */
+    void clear();
+
+    /**
+     * @brief The number of directories currently open
+    */
+    [[nodiscard]] size_t size() const { return _lru.size(); }
+
+    /**
+     * @brief The capacity of the cache
+    */
+    [[nodiscard]] size_t capacity() const { return _capacity; }
+};
+
+/**
+ * @brief Splits a path into its parent directory and its last component
+ *
+ * "/a/b" becomes "/a" and "b", "/a" becomes "/" and "a" and a name without
+ * a slash becomes "" and the name.
+ *
+ * @param path The path to split
+ * @returns The parent directory and the last component
+*/
+std::pair<std::string_view, std::string_view> split_path(std::string_view path);
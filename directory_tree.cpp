@@ -0,0 +1,185 @@
+/**
+* @file directory_tree.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the directory_tree class.
+ *
+ * Creates the target directories of a rename plan in one stage.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <littlesmith/util/Compat.h>
+#include <littlesmith/util/Parallel.h>
+#include "directory_tree.h"
+#include "probes.h"
+#include "run_stats.h"
+
+void directory_tree::add(std::string_view directory) {
+    // walk up until a known directory (or the root) is reached, remember the chain
+    std::vector<std::string_view> chain;
+    size_t parent = NONE;
+    while (!directory.empty()) {
+        auto it = _index.find(directory);
+        if (it != _index.end()) {
+            parent = it->second;
+            break;
+        }
+        chain.push_back(directory);
+        auto up = split_path(directory).first;
+        if (up == directory) {
+            break;
+        }
+        directory = up;
+    }
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        size_t depth = parent == NONE ? 0 : _nodes[parent].depth + 1;
+        _index.emplace(*it, _nodes.size());
+        _nodes.push_back({*it, parent, depth, {}, false});
+        parent = _nodes.size() - 1;
+    }
+}
+
+void directory_tree::make(node &directory, directory_cache &cache) {
+    if (directory.parent != NONE && _nodes[directory.parent].error) {
+        directory.error = _nodes[directory.parent].error;
+        return;
+    }
+    auto [parent, name] = split_path(directory.path);
+    if (name.empty() || parent == directory.path) {
+        // the root always exists
+        return;
+    }
+#ifdef __linux__
+    int fd = cache.open(parent);
+    if (fd == -1) {
+        directory.error = std::error_code(errno, std::system_category());
+        return;
+    }
+    directory.attempted = true;
+    MULTIRENAMER_PROBE2(mkdir__start, directory.path.data(), directory.path.size());
+    finish(directory, ::mkdirat(fd, std::string(name).c_str(), 0777) == 0 ? 0 : errno);
+#else
+    UNREFERENCED_PARAMETER(cache);
+    std::error_code error;
+    directory.attempted = true;
+    MULTIRENAMER_PROBE2(mkdir__start, directory.path.data(), directory.path.size());
+    directory.created = std::filesystem::create_directory(directory.path, error);
+    if (!error && !std::filesystem::is_directory(directory.path, error)) {
+        error = std::make_error_code(std::errc::not_a_directory);
+    }
+    MULTIRENAMER_PROBE3(mkdir__done, directory.path.data(), directory.path.size(), error.value());
+    if (error) {
+        run_stats::instance().mkdir_failures++;
+    }
+    directory.error = error;
+#endif
+}
+
+void directory_tree::count() const {
+    auto attempted = std::count_if(_nodes.begin(), _nodes.end(), [](const node &n) { return n.attempted; });
+    run_stats::instance().mkdirs.fetch_add(static_cast<uint64_t>(attempted), std::memory_order_relaxed);
+}
+
+void directory_tree::finish(node &directory, int error) {
+    MULTIRENAMER_PROBE3(mkdir__done, directory.path.data(), directory.path.size(), error);
+    if (error == 0) {
+        directory.created = true;
+        return;
+    }
+    std::error_code ec;
+    if (error == EEXIST && std::filesystem::is_directory(directory.path, ec)) {
+        return;
+    }
+    directory.error = std::error_code(error == EEXIST ? ENOTDIR : error, std::system_category());
+    run_stats::instance().mkdir_failures++;
+}
+
+std::vector<std::vector<size_t>> directory_tree::levels() const {
+    std::vector<std::vector<size_t>> levels;
+    for (size_t i = 0; i < _nodes.size(); i++) {
+        if (levels.size() <= _nodes[i].depth) {
+            levels.resize(_nodes[i].depth + 1);
+        }
+        levels[_nodes[i].depth].push_back(i);
+    }
+    return levels;
+}
+
+void directory_tree::create(unsigned threads, const cache_provider &caches) {
+    for (const auto &level: levels()) {
+        littlesmith::parallel_for(level.size(), threads, [&](size_t i, unsigned worker) {
+            make(_nodes[level[i]], caches(worker));
+        });
+    }
+    count();
+}
+
+void directory_tree::create(io_uring_queue &ring, directory_cache &cache) {
+    std::vector<std::string> names;
+    std::vector<io_completion> completions;
+    names.reserve(ring.capacity());
+    auto submit = [&](unsigned wait) {
+        completions.clear();
+        ring.submit(wait, completions);
+        names.clear();
+        for (const auto &completion: completions) {
+            finish(_nodes[completion.user_data], completion.result < 0 ? -completion.result : 0);
+        }
+    };
+    for (const auto &level: levels()) {
+        for (auto i: level) {
+            auto &directory = _nodes[i];
+            if (directory.parent != NONE && _nodes[directory.parent].error) {
+                directory.error = _nodes[directory.parent].error;
+                continue;
+            }
+            auto [parent, name] = split_path(directory.path);
+            if (name.empty() || parent == directory.path) {
+                continue;
+            }
+            // handles of queued mkdirs must stay open, so never let the cache evict
+            if (ring.pending() >= ring.capacity() ||
+                    cache.size() + std::count(parent.begin(), parent.end(), '/') + 1 >= cache.capacity()) {
+                submit(ring.pending());
+                cache.clear();
+            }
+            int fd = cache.open(parent);
+            if (fd == -1) {
+                directory.error = std::error_code(errno, std::system_category());
+                continue;
+            }
+            names.emplace_back(name);
+            ring.mkdir(fd, names.back().c_str(), 0777, i);
+            directory.attempted = true;
+            MULTIRENAMER_PROBE2(mkdir__start, directory.path.data(), directory.path.size());
+        }
+        // the next level needs all parents of this one
+        submit(ring.pending());
+    }
+    count();
+}
+
+std::error_code directory_tree::error(std::string_view directory) const {
+    auto it = _index.find(directory);
+    if (it == _index.end()) {
+        return {};
+    }
+    return _nodes[it->second].error;
+}
+
+std::vector<std::string_view> directory_tree::created() const {
+    std::vector<std::string_view> result;
+    for (const auto &directory: _nodes) {
+        if (directory.created) {
+            result.push_back(directory.path);
+        }
+    }
+    return result;
+}
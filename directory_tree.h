@@ -0,0 +1,100 @@
+/**
+* @file directory_tree.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the directory_tree class.
+ *
+ * Creates the target directories of a rename plan in one stage.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "directory_cache.h"
+#include "io_uring_queue.h"
+
+/**
+ * @brief The set of directories a rename plan needs, with all their ancestors
+ *
+ * Every directory is created exactly once, parents before children. The
+ * directories of one depth are independent of each other and are created
+ * in parallel with mkdirat relative to the (cached) parent, before the
+ * next level starts. Directories that already exist are fine.
+ *
+ * The tree keeps string_views, the paths must outlive it.
+*/
+class directory_tree {
+public:
+    /**
+     * @brief Returns the directory cache of a worker
+    */
+    using cache_provider = std::function<directory_cache&(unsigned worker)>;
+
+private:
+    struct node {
+        std::string_view path;
+        size_t parent;
+        size_t depth;
+        std::error_code error;
+        bool created{false};
+        /** @brief Whether mkdir was called, counted once per create() */
+        bool attempted{false};
+    };
+
+    static const size_t NONE = static_cast<size_t>(-1);
+
+    std::vector<node> _nodes;
+    std::unordered_map<std::string_view, size_t> _index;
+
+    void make(node& directory, directory_cache& cache);
+    void finish(node& directory, int error);
+    void count() const;
+    [[nodiscard]] std::vector<std::vector<size_t>> levels() const;
+
+public:
+    /**
+     * @brief Adds a directory and all its ancestors
+     *
+     * @param directory The directory
+    */
+    void add(std::string_view directory);
+
+    /**
+     * @brief Creates all directories that do not exist yet
+     *
+     * @param threads The number of worker threads
+     * @param caches Provides the directory cache of every worker
+    */
+    void create(unsigned threads, const cache_provider& caches);
+
+    /**
+     * @brief Creates all directories that do not exist yet with batched io_uring mkdirat operations
+     *
+     * @param ring The ring to use, up to its capacity mkdirs are in flight
+     * @param cache The directory cache for the parents
+    */
+    void create(io_uring_queue& ring, directory_cache& cache);
+
+    /**
+     * @brief The error that prevented a directory (or one of its ancestors) from being created
+     *
+     * @param directory A directory added before
+     * @returns The error, or an empty error_code if the directory exists
+    */
+    [[nodiscard]] std::error_code error(std::string_view directory) const;
+
+    /**
+     * @brief The directories that did not exist before and were created, parents first
+    */
+    [[nodiscard]] std::vector<std::string_view> created() const;
+
+    /**
+     * @brief The number of directories in the tree
+    */
+    [[nodiscard]] size_t size() const { return _nodes.size(); }
+};
@@ -0,0 +1,347 @@
+/**
+* @file directory_walker.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the directory_walker class.
+ *
+ * Enumerates a directory tree with a pool of work-stealing threads.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <system_error>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "directory_walker.h"
+#include "probes.h"
+
+#ifdef __linux__
+namespace {
+    /**
+     * @brief Layout of the records returned by getdents64 (see getdents(2))
+    */
+    struct linux_dirent64 {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    const size_t DIRENT_BUFFER_SIZE = 64 * 1024;
+}
+#endif
+
+directory_walker::directory_walker(bool recursive, unsigned threads, directory_callback callback, scan_index *index,
+                                   const scan_filter *filter, bool followSymlinks) :
+    _recursive(recursive), _follow_symlinks(followSymlinks), _threads(threads == 0 ? 1 : threads),
+    _callback(std::move(callback)), _index(index), _filter(filter), _queues(_threads) {
+}
+
+void directory_walker::walk(const std::filesystem::path &root) {
+    _failed = false;
+    _error = nullptr;
+    for (auto &shard: _visited) {
+        shard.inodes.clear();
+    }
+    _root_length = root.string().size();
+    if (!root.string().ends_with('/')) {
+        _root_length++;
+    }
+    _deferred.clear();
+    push(0, root);
+    // every round walks the directories reachable without symlinks, then the links found in it
+    while (true) {
+        if (_threads == 1) {
+            work(0);
+        } else {
+            std::vector<std::thread> workers;
+            workers.reserve(_threads);
+            for (unsigned i = 0; i < _threads; i++) {
+                workers.emplace_back(&directory_walker::work, this, i);
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        }
+        if (_error || _deferred.empty()) {
+            break;
+        }
+        for (auto &directory: _deferred) {
+            push(0, std::move(directory));
+        }
+        _deferred.clear();
+    }
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void directory_walker::push(unsigned worker, std::filesystem::path directory) {
+    // count first, so the walk can never look finished while work is in a queue
+    _pending.fetch_add(1);
+    std::lock_guard lock(_queues[worker].mutex);
+    _queues[worker].directories.push_back(std::move(directory));
+}
+
+bool directory_walker::pop(unsigned worker, std::filesystem::path &directory) {
+    std::lock_guard lock(_queues[worker].mutex);
+    auto &directories = _queues[worker].directories;
+    if (directories.empty()) {
+        return false;
+    }
+    directory = std::move(directories.back());
+    directories.pop_back();
+    return true;
+}
+
+bool directory_walker::steal(unsigned worker, std::filesystem::path &directory) {
+    for (unsigned i = 1; i < _threads; i++) {
+        auto &victim = _queues[(worker + i) % _threads];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.directories.empty()) {
+            directory = std::move(victim.directories.front());
+            victim.directories.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool directory_walker::visit(uint64_t device, uint64_t inode) {
+    std::pair<uint64_t, uint64_t> key{device, inode};
+    auto &shard = _visited[(inode_hash()(key) >> 16) % VISITED_SHARDS];
+    std::lock_guard lock(shard.mutex);
+    return shard.inodes.insert(key).second;
+}
+
+void directory_walker::work(unsigned worker) {
+    std::filesystem::path directory;
+    auto idle = std::chrono::microseconds(0);
+    while (!_failed) {
+        if (pop(worker, directory) || steal(worker, directory)) {
+            idle = std::chrono::microseconds(0);
+            try {
+                read(worker, directory);
+            } catch (...) {
+                std::lock_guard lock(_error_mutex);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+                _failed = true;
+            }
+            _pending.fetch_sub(1);
+            continue;
+        }
+        if (_pending == 0) {
+            break;
+        }
+        // others are still reading and may publish new subdirectories soon
+        if (idle < std::chrono::microseconds(1000)) {
+            idle += std::chrono::microseconds(50);
+        }
+        std::this_thread::sleep_for(idle);
+    }
+}
+
+void directory_walker::read(unsigned worker, const std::filesystem::path &directory) {
+    directory_listing listing;
+    directory_stamp stamp;
+    bool stamped = false;
+    bool cached = false;
+    auto &stats = run_stats::instance();
+    if (_index != nullptr || _follow_symlinks) {
+        struct stat st{};
+        bool found = ::stat(directory.c_str(), &st) == 0;
+        if (found && _follow_symlinks && !visit(st.st_dev, st.st_ino)) {
+            // already read through another path
+            stats.directories_skipped++;
+            return;
+        }
+        if (found && _index != nullptr) {
+            stamp.inode = st.st_ino;
+#ifdef __linux__
+            stamp.mtime_ns = st.st_mtim.tv_sec * 1'000'000'000LL + st.st_mtim.tv_nsec;
+            stamp.ctime_ns = st.st_ctim.tv_sec * 1'000'000'000LL + st.st_ctim.tv_nsec;
+#else
+            stamp.mtime_ns = st.st_mtime * 1'000'000'000LL;
+            stamp.ctime_ns = st.st_ctime * 1'000'000'000LL;
+#endif
+            stamped = true;
+            cached = _index->lookup(directory.string(), stamp, listing);
+        }
+    }
+    if (!cached) {
+        MULTIRENAMER_PROBE2(dir__open, directory.c_str(), directory.native().size());
+#ifdef __linux__
+        auto entries = list_native(directory, listing);
+#else
+        auto entries = list_portable(directory, listing);
+#endif
+        MULTIRENAMER_PROBE3(dir__close, directory.c_str(), directory.native().size(), entries);
+        stats.entries += entries;
+    } else {
+        stats.entries += listing.files.size() + listing.directories.size() + listing.links.size();
+        stats.directories_cached++;
+    }
+    stats.directories++;
+    stats.files += listing.files.size();
+    // last, the listing moves into the index
+    auto store = [&] {
+        if (stamped) {
+            _index->store(directory.string(), stamp, std::move(listing));
+        }
+    };
+
+    std::string prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix += '/';
+    }
+    // calls each with the name of every subdirectory to walk into and whether it is a symlink
+    auto subdirectories = [&](auto &&each) {
+        if (_recursive) {
+            for (const auto &name: listing.directories) {
+                each(name, false);
+            }
+            if (_follow_symlinks) {
+                for (const auto &name: listing.links) {
+                    each(name, true);
+                }
+            }
+        }
+    };
+    // links wait for the next round, so a directory is found by its real path first if there is one
+    auto enqueue = [&](std::string path, bool link) {
+        if (link) {
+            std::lock_guard lock(_deferred_mutex);
+            _deferred.emplace_back(std::move(path));
+        } else {
+            push(worker, std::move(path));
+        }
+    };
+    if (_filter == nullptr) {
+        subdirectories([&](const std::string &name, bool link) {
+            enqueue(prefix + name, link);
+        });
+        std::vector<std::string> files;
+        files.reserve(listing.files.size());
+        for (const auto &name: listing.files) {
+            files.emplace_back(prefix + name);
+        }
+        store();
+        _callback(directory, files);
+        return;
+    }
+    // the path relative to the root, for the patterns containing a /, and the depth of the subdirectories
+    std::string_view relative;
+    if (prefix.size() > _root_length) {
+        relative = std::string_view(prefix).substr(_root_length);
+    }
+    auto depth = static_cast<unsigned>(std::count(relative.begin(), relative.end(), '/')) + 1;
+    uint64_t pruned = 0;
+    subdirectories([&](const std::string &name, bool link) {
+        auto path = prefix + name;
+        if (_filter->descend(std::string_view(path).substr(_root_length), name, depth)) {
+            enqueue(std::move(path), link);
+        } else {
+            pruned++;
+        }
+    });
+    std::vector<std::string> files;
+    files.reserve(listing.files.size());
+    for (const auto &name: listing.files) {
+        auto path = prefix + name;
+        if (_filter->select(std::string_view(path).substr(_root_length), name) && _filter->newer(path)) {
+            files.emplace_back(std::move(path));
+        }
+    }
+    stats.directories_pruned += pruned;
+    stats.files_filtered += listing.files.size() - files.size();
+    store();
+    _callback(directory, files);
+}
+
+size_t directory_walker::list_portable(const std::filesystem::path &directory, directory_listing &listing) {
+    size_t entries = 0;
+    for (auto const &entry: std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied)) {
+        entries++;
+        if (entry.is_regular_file()) {
+            listing.files.emplace_back(entry.path().filename().string());
+        }
+        if (entry.is_directory()) {
+            (entry.is_symlink() ? listing.links : listing.directories).emplace_back(entry.path().filename().string());
+        }
+    }
+    return entries;
+}
+
+#ifdef __linux__
+size_t directory_walker::list_native(const std::filesystem::path &directory, directory_listing &listing) {
+    size_t entries = 0;
+    int fd = ::openat(AT_FDCWD, directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == EACCES) {
+            // same as directory_options::skip_permission_denied
+            return entries;
+        }
+        throw std::filesystem::filesystem_error("directory_iterator::directory_iterator", directory,
+                                                std::error_code(errno, std::system_category()));
+    }
+    thread_local std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+    while (true) {
+        auto n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (n < 0) {
+            auto error = errno;
+            ::close(fd);
+            throw std::filesystem::filesystem_error("directory_iterator::operator++", directory,
+                                                    std::error_code(error, std::system_category()));
+        }
+        if (n == 0) {
+            break;
+        }
+        for (long offset = 0; offset < n;) {
+            auto entry = reinterpret_cast<const linux_dirent64 *>(buffer.data() + offset);
+            offset += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+                continue;
+            }
+            entries++;
+            auto type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                struct stat st{};
+                if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                type = S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG :
+                       S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+            }
+            bool link = type == DT_LNK;
+            if (link) {
+                // like directory_entry::is_regular_file/is_directory, the target decides
+                struct stat st{};
+                if (::fstatat(fd, name, &st, 0) != 0) {
+                    continue;
+                }
+                type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_UNKNOWN;
+            }
+            if (type == DT_REG) {
+                listing.files.emplace_back(name);
+            } else if (type == DT_DIR) {
+                (link ? listing.links : listing.directories).emplace_back(name);
+            }
+        }
+    }
+    ::close(fd);
+    return entries;
+}
+#endif
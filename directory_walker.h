@@ -0,0 +1,144 @@
+/**
+* @file directory_walker.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the directory_walker class.
+ *
+ * Enumerates a directory tree with a pool of work-stealing threads.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "scan_index.h"
+#include "scan_filter.h"
+#include "run_stats.h"
+
+/**
+ * @brief Walks a directory tree, optionally on several threads
+ *
+ * Every worker owns a queue of directories still to be read. New
+ * subdirectories are pushed to the back of the own queue and taken from
+ * there again (depth first, like the old single stack). A worker running
+ * out of work steals from the front of another worker's queue, which is
+ * where the oldest and therefore usually the largest subtrees wait.
+ *
+ * With a single thread the walk runs in the calling thread and visits the
+ * directories in exactly the same order as the former stack based scan.
+ *
+ * On Linux the directories are read with getdents64 and the entries are
+ * classified by their d_type, so no stat call is needed per entry. Only
+ * symlinks and filesystems reporting DT_UNKNOWN cost an fstatat. Other
+ * platforms use std::filesystem::directory_iterator.
+ *
+ * With a scan_index, every directory is stat'ed first and only read if
+ * its stamp differs from the one in the index.
+ *
+ * Symlinks to directories are only walked with follow_symlinks. Then
+ * every directory is stat'ed before it is read, and a directory whose
+ * device and inode were already visited, through another link or its real
+ * path, is skipped. So every directory is read once and symlink cycles
+ * end. The links are only walked after everything reachable without them,
+ * so a directory below the root is reported by its real path.
+ *
+ * With a scan_filter, subdirectories it rejects are never queued, so
+ * excluded trees are not opened at all. The files are filtered after the
+ * listing, the index always stores the complete listing.
+*/
+class directory_walker {
+public:
+    /**
+     * @brief Callback receiving the regular files of one directory
+     *
+     * Called once per directory from the worker that read it. Calls from
+     * different workers may run concurrently.
+     *
+     * @param directory The directory that was read
+     * @param files The full paths of the regular files in the directory
+    */
+    using directory_callback = std::function<void(const std::filesystem::path& directory,
+                                                  std::vector<std::string>& files)>;
+
+private:
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<std::filesystem::path> directories;
+    };
+
+    struct inode_hash {
+        size_t operator()(const std::pair<uint64_t, uint64_t>& inode) const {
+            return std::hash<uint64_t>()(inode.first * 0x9E3779B97F4A7C15ULL ^ inode.second);
+        }
+    };
+
+    /** @brief One part of the set of visited directories, each with its own lock */
+    struct visited_shard {
+        std::mutex mutex;
+        std::unordered_set<std::pair<uint64_t, uint64_t>, inode_hash> inodes;
+    };
+
+    static constexpr size_t VISITED_SHARDS = 64;
+
+    bool _recursive;
+    bool _follow_symlinks;
+    unsigned _threads;
+    directory_callback _callback;
+    scan_index* _index;
+    const scan_filter* _filter;
+    size_t _root_length{0};
+
+    std::vector<work_queue> _queues;
+    std::array<visited_shard, VISITED_SHARDS> _visited;
+    std::mutex _deferred_mutex;
+    std::vector<std::filesystem::path> _deferred;
+    std::atomic<size_t> _pending{0};
+    std::atomic<bool> _failed{false};
+    std::mutex _error_mutex;
+    std::exception_ptr _error;
+
+    void push(unsigned worker, std::filesystem::path directory);
+    bool pop(unsigned worker, std::filesystem::path& directory);
+    bool steal(unsigned worker, std::filesystem::path& directory);
+    bool visit(uint64_t device, uint64_t inode);
+    void work(unsigned worker);
+    void read(unsigned worker, const std::filesystem::path& directory);
+    static size_t list_portable(const std::filesystem::path& directory, directory_listing& listing);
+#ifdef __linux__
+    static size_t list_native(const std::filesystem::path& directory, directory_listing& listing);
+#endif
+
+public:
+    /**
+     * @brief Constructor for the directory_walker
+     *
+     * @param recursive If true, also walk into subdirectories
+     * @param threads The number of worker threads (0 is treated as 1)
+     * @param callback The callback receiving the files of every directory
+     * @param index Optional index of a previous scan, updated during the walk
+     * @param filter Optional filter selecting the directories to read and the files to report
+     * @param followSymlinks If true, also walk into symlinks to directories, every directory only once
+    */
+    directory_walker(bool recursive, unsigned threads, directory_callback callback, scan_index* index = nullptr,
+                     const scan_filter* filter = nullptr, bool followSymlinks = false);
+
+    /**
+     * @brief Walks the tree below root and returns when every directory was read
+     *
+     * The first exception thrown by any worker stops the walk and is
+     * rethrown here.
+     *
+     * @param root The directory to start with
+    */
+    void walk(const std::filesystem::path& root);
+};
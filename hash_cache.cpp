@@ -0,0 +1,240 @@
+/**
+* @file hash_cache.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the hash_cache class.
+ *
+ * Remembers content hashes between scans.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "hash_cache.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[8] = {'M', 'R', 'H', 'A', 'S', 'H', '0', '1'};
+    const uint64_t FREE = 0;
+    const uint64_t BUSY = 1;
+    /** @brief Slots looked at before a lookup misses or an insert gives up */
+    const uint64_t MAX_PROBES = 32;
+
+    uint64_t mix(uint64_t x) {
+        // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    uint64_t tag_of(const file_key& key) {
+        uint64_t h = mix(key.device ^ mix(key.inode ^ mix(key.size ^ mix(static_cast<uint64_t>(key.mtime_ns)))));
+        return h <= BUSY ? h + 2 : h;
+    }
+
+    uint64_t check_of(uint64_t tag, const uint8_t* digest) {
+        uint64_t h = tag;
+        for (size_t i = 0; i < hash_cache::DIGEST_SIZE; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, digest + i, sizeof(word));
+            h = mix(h ^ word);
+        }
+        return h;
+    }
+}
+
+struct hash_cache::header {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t reserved[5];
+};
+
+struct hash_cache::entry {
+    uint64_t tag;
+    file_key key;
+    uint64_t check;
+    uint8_t digest[DIGEST_SIZE];
+};
+
+hash_cache::hash_cache(const std::filesystem::path &path) : _path(path) {
+    _racy_after_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            (std::chrono::system_clock::now() - std::chrono::seconds(2)).time_since_epoch()).count();
+    if (!map(0, false)) {
+        rebuild(INITIAL_CAPACITY);
+    }
+}
+
+hash_cache::~hash_cache() {
+    unmap();
+}
+
+#ifdef __linux__
+
+bool hash_cache::map(uint64_t capacity, bool create) {
+    unmap();
+    auto file = create ? std::filesystem::path(_path).concat(".tmp") : _path;
+    int fd = ::open(file.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDWR | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st{};
+    if (create) {
+        if (::ftruncate(fd, static_cast<off_t>(sizeof(header) + capacity * sizeof(entry))) != 0) {
+            ::close(fd);
+            return false;
+        }
+    } else {
+        header h{};
+        if (::fstat(fd, &st) != 0 || ::pread(fd, &h, sizeof(h), 0) != sizeof(h) ||
+                std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.capacity == 0 ||
+                (h.capacity & (h.capacity - 1)) != 0 ||
+                static_cast<uint64_t>(st.st_size) != sizeof(header) + h.capacity * sizeof(entry)) {
+            ::close(fd);
+            return false;
+        }
+        capacity = h.capacity;
+    }
+    _mapping_size = sizeof(header) + capacity * sizeof(entry);
+    _mapping = ::mmap(nullptr, _mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (_mapping == MAP_FAILED) {
+        _mapping = nullptr;
+        ::close(fd);
+        return false;
+    }
+    _fd = fd;
+    _header = static_cast<header *>(_mapping);
+    _entries = reinterpret_cast<entry *>(static_cast<char *>(_mapping) + sizeof(header));
+    _mask = capacity - 1;
+    if (create) {
+        std::memcpy(_header->magic, MAGIC, sizeof(MAGIC));
+        _header->capacity = capacity;
+        _header->count = 0;
+    }
+    return true;
+}
+
+void hash_cache::unmap() {
+    if (_mapping != nullptr) {
+        ::munmap(_mapping, _mapping_size);
+    }
+    if (_fd != -1) {
+        ::close(_fd);
+    }
+    _mapping = nullptr;
+    _header = nullptr;
+    _entries = nullptr;
+    _fd = -1;
+}
+
+#else
+
+bool hash_cache::map(uint64_t, bool) {
+    return false;
+}
+
+void hash_cache::unmap() {
+}
+
+#endif
+
+void hash_cache::rebuild(uint64_t capacity) {
+    // copy the valid entries of the current table into a new file, then replace the old one
+    std::vector<entry> entries;
+    if (available()) {
+        for (uint64_t i = 0; i <= _mask; i++) {
+            auto tag = std::atomic_ref<uint64_t>(_entries[i].tag).load(std::memory_order_acquire);
+            if (tag > BUSY && _entries[i].check == check_of(tag, _entries[i].digest)) {
+                entries.push_back(_entries[i]);
+            }
+        }
+    }
+    if (!map(capacity, true)) {
+        return;
+    }
+    for (const auto &e: entries) {
+        insert(e.key, e.digest);
+    }
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(_path).concat(".tmp"), _path, error);
+    if (error) {
+        unmap();
+    }
+}
+
+bool hash_cache::lookup(const file_key &key, uint8_t *digest) const {
+    if (!available()) {
+        return false;
+    }
+    auto tag = tag_of(key);
+    for (uint64_t probe = 0; probe < MAX_PROBES; probe++) {
+        auto &e = _entries[(tag + probe) & _mask];
+        auto current = std::atomic_ref<uint64_t>(e.tag).load(std::memory_order_acquire);
+        if (current == FREE) {
+            return false;
+        }
+        if (current == tag && e.key == key && e.check == check_of(tag, e.digest)) {
+            std::memcpy(digest, e.digest, DIGEST_SIZE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void hash_cache::insert(const file_key &key, const uint8_t *digest) {
+    if (!available() || key.mtime_ns > _racy_after_ns) {
+        return;
+    }
+    auto tag = tag_of(key);
+    for (uint64_t probe = 0; probe < MAX_PROBES; probe++) {
+        auto &e = _entries[(tag + probe) & _mask];
+        std::atomic_ref<uint64_t> slot(e.tag);
+        auto current = slot.load(std::memory_order_acquire);
+        if (current == tag && e.key == key) {
+            return;
+        }
+        if (current != FREE || !slot.compare_exchange_strong(current, BUSY, std::memory_order_acquire)) {
+            // taken by another key, or just claimed by another writer
+            continue;
+        }
+        e.key = key;
+        std::memcpy(e.digest, digest, DIGEST_SIZE);
+        e.check = check_of(tag, digest);
+        slot.store(tag, std::memory_order_release);
+        std::atomic_ref<uint64_t>(_header->count).fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t hash_cache::size() const {
+    return available() ? std::atomic_ref<uint64_t>(_header->count).load(std::memory_order_relaxed) : 0;
+}
+
+void hash_cache::close() {
+    // the dropped inserts need room as well, or a large tree would take several runs to be cached
+    auto needed = size() + _dropped.exchange(0, std::memory_order_relaxed);
+    if (available() && needed > (_mask + 1) / 2) {
+        rebuild(std::max<uint64_t>(2 * (_mask + 1), [](uint64_t n) {
+            uint64_t capacity = 1;
+            while (capacity < n) {
+                capacity <<= 1;
+            }
+            return capacity;
+        }(4 * needed)));
+    }
+    _dropped.store(0, std::memory_order_relaxed);
+    unmap();
+}
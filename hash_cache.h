@@ -0,0 +1,123 @@
+/**
+* @file hash_cache.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the hash_cache class.
+ *
+ * Remembers content hashes between scans.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Identifies a version of a file
+*/
+struct file_key {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+
+    bool operator==(const file_key&) const = default;
+};
+
+/**
+ * @brief Persistent cache of SHA-256 digests
+ *
+ * An open-addressed hash table (linear probing) in a file that is mapped
+ * into memory as it is, lookups work directly on the mapping without
+ * loading anything. Every slot starts with a tag: 0 for free, 1 while a
+ * writer fills the slot, otherwise a hash of the key. A writer claims a
+ * free slot with a compare-and-swap of the tag and publishes the entry by
+ * storing the final tag, so lookups and inserts from several threads (and
+ * processes) need no lock. Every entry also carries a check value over
+ * key and digest, entries torn by a crash are ignored.
+ *
+ * Entries are never removed. A file that changes gets a new key, the old
+ * entry stays until the table is rebuilt. Inserts into a full neighbourhood
+ * are dropped, the cache is only an optimization, but they are counted:
+ * when the entries and the dropped inserts together fill more than half of
+ * the table on close(), it is rebuilt with room for four times as many, so
+ * the next run has space for all of them.
+ *
+ * Like the scan_index, files modified less than two seconds before they
+ * were hashed are not cached: they may change again within the same
+ * timestamp tick.
+*/
+class hash_cache {
+public:
+    /** @brief Size of a digest */
+    static const size_t DIGEST_SIZE = 32;
+    /** @brief Number of slots of a new table */
+    static const uint64_t INITIAL_CAPACITY = 1 << 16;
+
+private:
+    struct header;
+    struct entry;
+
+    std::filesystem::path _path;
+    int _fd{-1};
+    void* _mapping{nullptr};
+    size_t _mapping_size{0};
+    header* _header{nullptr};
+    entry* _entries{nullptr};
+    uint64_t _mask{0};
+    int64_t _racy_after_ns;
+    /** @brief Inserts dropped because all slots they could go to were taken */
+    std::atomic<uint64_t> _dropped{0};
+
+    bool map(uint64_t capacity, bool create);
+    void unmap();
+    void rebuild(uint64_t capacity);
+
+public:
+    /**
+     * @brief Constructor for the hash_cache, maps the cache file and creates it if needed
+     *
+     * A cache file that cannot be used is replaced by an empty one. If no
+     * file can be created at all, the cache stays unavailable and lookups
+     * simply miss.
+     *
+     * @param path The cache file
+    */
+    explicit hash_cache(const std::filesystem::path& path);
+    hash_cache(const hash_cache&) = delete;
+    hash_cache& operator=(const hash_cache&) = delete;
+    ~hash_cache();
+
+    /**
+     * @brief True if the cache file is mapped
+    */
+    [[nodiscard]] bool available() const { return _entries != nullptr; }
+
+    /**
+     * @brief Looks up the digest of a file
+     *
+     * @param key The file
+     * @param digest Receives DIGEST_SIZE bytes
+     * @returns false if the file is not in the cache
+    */
+    bool lookup(const file_key& key, uint8_t* digest) const;
+
+    /**
+     * @brief Adds the digest of a file
+     *
+     * @param key The file
+     * @param digest DIGEST_SIZE bytes
+    */
+    void insert(const file_key& key, const uint8_t* digest);
+
+    /**
+     * @brief The number of entries in the cache
+    */
+    [[nodiscard]] uint64_t size() const;
+
+    /**
+     * @brief Unmaps the cache, rebuilding it first if it is getting full
+    */
+    void close();
+};
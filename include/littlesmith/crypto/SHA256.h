@@ -12,34 +12,110 @@
 #include <cstdint>
 #include <vector>
 #include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LITTLESMITH_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 namespace littlesmith {
 
+    /**
+     * @brief The implementations of the SHA-256 compression function
+    */
+    enum class sha256_kernel {
+        /** @brief Portable C++ */
+        scalar,
+        /** @brief x86 SHA extensions, one message at a time */
+        sha_ni,
+        /** @brief AVX2, 8 independent messages at a time (only for SHA256::hashMany) */
+        avx2_multi_buffer
+    };
+
     class SHA256 {
     public:
         static const unsigned int DIGEST_SIZE = (256 / 8);
 
-        void init();
+        /**
+         * @brief Starts a new hash with the fastest kernel the CPU supports
+        */
+        void init() { init(best()); }
+
+        /**
+         * @brief Starts a new hash with a specific kernel
+         *
+         * @throws std::invalid_argument if the kernel is not supported or not a single buffer kernel
+        */
+        void init(sha256_kernel kernel);
 
         void update(const std::string& message) { update(reinterpret_cast<const uint8_t*>(message.data()), message.length()); }
 
-        void update(const uint8_t *message, unsigned int len);
+        void update(const uint8_t *message, size_t len);
 
         std::vector<uint8_t> final();
 
         void final(uint8_t *digest);
 
+        /**
+         * @brief Hashes a string
+         *
+         * @returns The digest as 64 lower case hex digits
+        */
         static std::string hashString(const std::string &input);
+
+        /**
+         * @brief Hashes many independent messages
+         *
+         * With avx2_multi_buffer 8 messages are hashed at once, lanes that
+         * finish are refilled with the next message. The other kernels hash
+         * the messages one after the other.
+         *
+         * @param messages The messages
+         * @param lengths The length of every message
+         * @param count The number of messages
+         * @param digests Receives count * DIGEST_SIZE bytes
+         * @param kernel The kernel
+        */
+        static void hashMany(const uint8_t* const* messages, const size_t* lengths, size_t count,
+                             uint8_t* digests, sha256_kernel kernel);
+
+        static void hashMany(const uint8_t* const* messages, const size_t* lengths, size_t count, uint8_t* digests) {
+            hashMany(messages, lengths, count, digests,
+                     supported(sha256_kernel::sha_ni) || !supported(sha256_kernel::avx2_multi_buffer)
+                        ? best() : sha256_kernel::avx2_multi_buffer);
+        }
+
+        /**
+         * @brief True if the CPU supports a kernel
+        */
+        static bool supported(sha256_kernel kernel);
+
+        /**
+         * @brief The fastest single buffer kernel the CPU supports
+        */
+        static sha256_kernel best() { return supported(sha256_kernel::sha_ni) ? sha256_kernel::sha_ni : sha256_kernel::scalar; }
     private:
+        using transform_function = void (*)(uint32_t *state, const uint8_t *message, size_t block_nb);
 
         const static uint32_t sha256_k[];
         static const unsigned int SHA224_256_BLOCK_SIZE = (512 / 8);
-        static void unpack(unsigned int x, uint8_t *str);
-        static void pack(const uint8_t *str, unsigned int *x);
-        void transform(const uint8_t *message, unsigned int block_nb);
+        static void unpack(uint32_t x, uint8_t *str);
+        static void pack(const uint8_t *str, uint32_t *x);
+        static void initState(uint32_t *state);
+        static size_t pad(const uint8_t *tail, size_t tail_len, uint64_t total_len, uint8_t *block);
+        static void transformScalar(uint32_t *state, const uint8_t *message, size_t block_nb);
+#ifdef LITTLESMITH_SHA256_X86
+        static void transformShaNi(uint32_t *state, const uint8_t *message, size_t block_nb);
+        static void transformAvx2(uint32_t (*state)[8], const uint8_t* const* blocks);
+#endif
+        static transform_function function(sha256_kernel kernel);
 
-        unsigned int m_tot_len;
-        unsigned int m_len;
+        transform_function m_transform;
+        uint64_t m_tot_len;
+        size_t m_len;
         uint8_t m_block[2 * SHA224_256_BLOCK_SIZE];
         uint32_t m_h[8];
 
@@ -49,21 +125,21 @@ namespace littlesmith {
         static uint32_t f4(uint32_t x) { return (rotate_right(x, 17) ^ rotate_right(x, 19) ^ shift_right(x, 10)); }
     };
 
-    void SHA256::unpack(unsigned int x, uint8_t *str) {
+    inline void SHA256::unpack(uint32_t x, uint8_t *str) {
         *((str) + 3) = (uint8_t) ((x));
         *((str) + 2) = (uint8_t) ((x) >> 8);
         *((str) + 1) = (uint8_t) ((x) >> 16);
         *((str) + 0) = (uint8_t) ((x) >> 24);
     }
 
-    void SHA256::pack(const uint8_t *str, unsigned int *x) {
+    inline void SHA256::pack(const uint8_t *str, uint32_t *x) {
         *(x) = ((uint32_t) *((str) + 3))
                | ((uint32_t) *((str) + 2) << 8)
                | ((uint32_t) *((str) + 1) << 16)
                | ((uint32_t) *((str) + 0) << 24);
     }
 
-    const unsigned int SHA256::sha256_k[64] = //UL = uint32_t
+    inline const uint32_t SHA256::sha256_k[64] = //UL = uint32_t
             {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
              0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
              0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
@@ -81,14 +157,14 @@ namespace littlesmith {
              0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
              0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
-    void SHA256::transform(const uint8_t *message, unsigned int block_nb) {
+    inline void SHA256::transformScalar(uint32_t *state, const uint8_t *message, size_t block_nb) {
         uint32_t w[64];
         uint32_t wv[8];
         uint32_t t1, t2;
         const uint8_t *sub_block;
-        int i;
+        size_t i;
         int j;
-        for (i = 0; i < (int) block_nb; i++) {
+        for (i = 0; i < block_nb; i++) {
             sub_block = message + (i << 6);
             for (j = 0; j < 16; j++) {
                 pack(&sub_block[j << 2], &w[j]);
@@ -97,7 +173,7 @@ namespace littlesmith {
                 w[j] = f4(w[j - 2]) + w[j - 7] + f3(w[j - 15]) + w[j - 16];
             }
             for (j = 0; j < 8; j++) {
-                wv[j] = m_h[j];
+                wv[j] = state[j];
             }
             for (j = 0; j < 64; j++) {
                 t1 = wv[7] + f2(wv[4]) + choose(wv[4], wv[5], wv[6])
@@ -113,27 +189,162 @@ namespace littlesmith {
                 wv[0] = t1 + t2;
             }
             for (j = 0; j < 8; j++) {
-                m_h[j] += wv[j];
+                state[j] += wv[j];
             }
         }
     }
 
-    void SHA256::init() {
-        m_h[0] = 0x6a09e667;
-        m_h[1] = 0xbb67ae85;
-        m_h[2] = 0x3c6ef372;
-        m_h[3] = 0xa54ff53a;
-        m_h[4] = 0x510e527f;
-        m_h[5] = 0x9b05688c;
-        m_h[6] = 0x1f83d9ab;
-        m_h[7] = 0x5be0cd19;
+#ifdef LITTLESMITH_SHA256_X86
+    namespace detail {
+        __attribute__((target("avx2"), always_inline))
+        inline __m256i rotate_right_x8(__m256i x, int n) {
+            return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+        }
+    }
+
+    __attribute__((target("sha,sse4.1")))
+    inline void SHA256::transformShaNi(uint32_t *state, const uint8_t *message, size_t block_nb) {
+        const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        // the instructions want the state as ABEF / CDGH
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+        for (size_t i = 0; i < block_nb; i++, message += SHA224_256_BLOCK_SIZE) {
+            __m128i abef = state0;
+            __m128i cdgh = state1;
+            __m128i w[4];
+            for (int j = 0; j < 16; j++) {
+                if (j < 4) {
+                    w[j] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(message + 16 * j)), mask);
+                } else {
+                    // w[j] = sigma1(w[j-2]) + w[j-7] + sigma0(w[j-15]) + w[j-16], four words at a time
+                    __m128i t = _mm_sha256msg1_epu32(w[j & 3], w[(j + 1) & 3]);
+                    t = _mm_add_epi32(t, _mm_alignr_epi8(w[(j + 3) & 3], w[(j + 2) & 3], 4));
+                    w[j & 3] = _mm_sha256msg2_epu32(t, w[(j + 3) & 3]);
+                }
+                __m128i k = _mm_add_epi32(w[j & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&sha256_k[4 * j])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(k, 0x0E));
+            }
+            state0 = _mm_add_epi32(state0, abef);
+            state1 = _mm_add_epi32(state1, cdgh);
+        }
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));
+    }
+
+    __attribute__((target("avx2")))
+    inline void SHA256::transformAvx2(uint32_t (*state)[8], const uint8_t* const* blocks) {
+        // state[word][lane], one block of every lane
+        const __m256i swap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                             12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        __m256i w[16];
+        for (int j = 0; j < 16; j++) {
+            uint32_t words[8];
+            for (int l = 0; l < 8; l++) {
+                memcpy(&words[l], blocks[l] + (j << 2), sizeof(uint32_t));
+            }
+            w[j] = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words)), swap);
+        }
+        __m256i wv[8];
+        for (int j = 0; j < 8; j++) {
+            wv[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[j]));
+        }
+        for (int j = 0; j < 64; j++) {
+            if (j >= 16) {
+                __m256i w2 = w[(j - 2) & 15];
+                __m256i w15 = w[(j - 15) & 15];
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(detail::rotate_right_x8(w2, 17), detail::rotate_right_x8(w2, 19)), _mm256_srli_epi32(w2, 10));
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(detail::rotate_right_x8(w15, 7), detail::rotate_right_x8(w15, 18)), _mm256_srli_epi32(w15, 3));
+                w[j & 15] = _mm256_add_epi32(_mm256_add_epi32(s1, w[(j - 7) & 15]), _mm256_add_epi32(s0, w[j & 15]));
+            }
+            __m256i e = wv[4];
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(detail::rotate_right_x8(e, 6), detail::rotate_right_x8(e, 11)), detail::rotate_right_x8(e, 25));
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, wv[5]), _mm256_andnot_si256(e, wv[6]));
+            __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(wv[7], s1),
+                                          _mm256_add_epi32(_mm256_add_epi32(ch, w[j & 15]),
+                                                           _mm256_set1_epi32(static_cast<int>(sha256_k[j]))));
+            __m256i a = wv[0];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(detail::rotate_right_x8(a, 2), detail::rotate_right_x8(a, 13)), detail::rotate_right_x8(a, 22));
+            __m256i maj = _mm256_or_si256(_mm256_and_si256(a, wv[1]), _mm256_and_si256(wv[2], _mm256_or_si256(a, wv[1])));
+            wv[7] = wv[6];
+            wv[6] = wv[5];
+            wv[5] = wv[4];
+            wv[4] = _mm256_add_epi32(wv[3], t1);
+            wv[3] = wv[2];
+            wv[2] = wv[1];
+            wv[1] = wv[0];
+            wv[0] = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+        }
+        for (int j = 0; j < 8; j++) {
+            auto h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[j]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[j]), _mm256_add_epi32(h, wv[j]));
+        }
+    }
+#endif
+
+    inline bool SHA256::supported(sha256_kernel kernel) {
+#ifdef LITTLESMITH_SHA256_X86
+        static const bool sha_ni = [] {
+            unsigned int eax, ebx, ecx, edx;
+            return __builtin_cpu_supports("sse4.1") &&
+                   __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29)) != 0;
+        }();
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+#else
+        const bool sha_ni = false;
+        const bool avx2 = false;
+#endif
+        switch (kernel) {
+            case sha256_kernel::scalar:
+                return true;
+            case sha256_kernel::sha_ni:
+                return sha_ni;
+            case sha256_kernel::avx2_multi_buffer:
+                return avx2;
+        }
+        return false;
+    }
+
+    inline SHA256::transform_function SHA256::function(sha256_kernel kernel) {
+        if (!supported(kernel)) {
+            throw std::invalid_argument("SHA-256 kernel not supported by this CPU");
+        }
+#ifdef LITTLESMITH_SHA256_X86
+        if (kernel == sha256_kernel::sha_ni) {
+            return transformShaNi;
+        }
+#endif
+        return transformScalar;
+    }
+
+    inline void SHA256::initState(uint32_t *state) {
+        state[0] = 0x6a09e667;
+        state[1] = 0xbb67ae85;
+        state[2] = 0x3c6ef372;
+        state[3] = 0xa54ff53a;
+        state[4] = 0x510e527f;
+        state[5] = 0x9b05688c;
+        state[6] = 0x1f83d9ab;
+        state[7] = 0x5be0cd19;
+    }
+
+    inline void SHA256::init(sha256_kernel kernel) {
+        if (kernel == sha256_kernel::avx2_multi_buffer) {
+            throw std::invalid_argument("SHA-256 multi buffer kernel can only be used with hashMany");
+        }
+        m_transform = function(kernel);
+        initState(m_h);
         m_len = 0;
         m_tot_len = 0;
     }
 
-    void SHA256::update(const uint8_t *message, unsigned int len) {
-        unsigned int block_nb;
-        unsigned int new_len, rem_len, tmp_len;
+    inline void SHA256::update(const uint8_t *message, size_t len) {
+        size_t block_nb;
+        size_t new_len, rem_len, tmp_len;
         const uint8_t *shifted_message;
         tmp_len = SHA224_256_BLOCK_SIZE - m_len;
         rem_len = len < tmp_len ? len : tmp_len;
@@ -145,48 +356,159 @@ namespace littlesmith {
         new_len = len - rem_len;
         block_nb = new_len / SHA224_256_BLOCK_SIZE;
         shifted_message = message + rem_len;
-        transform(m_block, 1);
-        transform(shifted_message, block_nb);
+        m_transform(m_h, m_block, 1);
+        m_transform(m_h, shifted_message, block_nb);
         rem_len = new_len % SHA224_256_BLOCK_SIZE;
         memcpy(m_block, &shifted_message[block_nb << 6], rem_len);
         m_len = rem_len;
-        m_tot_len += (block_nb + 1) << 6;
+        m_tot_len += static_cast<uint64_t>(block_nb + 1) << 6;
+    }
+
+    /**
+     * @brief Writes the padded last block(s) of a message
+     *
+     * @returns The number of blocks written to block (1 or 2)
+    */
+    inline size_t SHA256::pad(const uint8_t *tail, size_t tail_len, uint64_t total_len, uint8_t *block) {
+        size_t block_nb = (1 + ((SHA224_256_BLOCK_SIZE - 9) < (tail_len % SHA224_256_BLOCK_SIZE)));
+        uint64_t len_b = total_len << 3;
+        size_t pm_len = block_nb << 6;
+        memmove(block, tail, tail_len);
+        memset(block + tail_len, 0, pm_len - tail_len);
+        block[tail_len] = 0x80;
+        unpack(static_cast<uint32_t>(len_b >> 32), block + pm_len - 8);
+        unpack(static_cast<uint32_t>(len_b), block + pm_len - 4);
+        return block_nb;
     }
 
-    void SHA256::final(uint8_t *digest) {
-        unsigned int block_nb;
-        unsigned int pm_len;
-        unsigned int len_b;
+    inline void SHA256::final(uint8_t *digest) {
         int i;
-        block_nb = (1 + ((SHA224_256_BLOCK_SIZE - 9)
-                         < (m_len % SHA224_256_BLOCK_SIZE)));
-        len_b = (m_tot_len + m_len) << 3;
-        pm_len = block_nb << 6;
-        memset(m_block + m_len, 0, pm_len - m_len);
-        m_block[m_len] = 0x80;
-        unpack(len_b, m_block + pm_len - 4);
-        transform(m_block, block_nb);
+        size_t block_nb = pad(m_block, m_len, m_tot_len + m_len, m_block);
+        m_transform(m_h, m_block, block_nb);
         for (i = 0; i < 8; i++) {
             unpack(m_h[i], &digest[i << 2]);
         }
     }
 
-    std::vector<uint8_t> SHA256::final() {
+    inline std::vector<uint8_t> SHA256::final() {
         auto buffer = std::vector<uint8_t>(SHA256::DIGEST_SIZE, 0);
         final(buffer.data());
         return buffer;
     }
 
-    std::string SHA256::hashString(const std::string &input) {
+    inline std::string SHA256::hashString(const std::string &input) {
         SHA256 ctx{};
         ctx.init();
         ctx.update(input);
         auto digest = ctx.final();
 
         std::stringstream ss;
+        ss << std::hex;
         for (const auto &byte: digest) {
-            ss << std::setw(2) << std::setfill('0') << byte;
+            ss << std::setw(2) << std::setfill('0') << static_cast<unsigned int>(byte);
         }
         return {ss.str()};
     }
-}
\ No newline at end of file
+
+    inline void SHA256::hashMany(const uint8_t* const* messages, const size_t* lengths, size_t count,
+                                 uint8_t* digests, sha256_kernel kernel) {
+        if (kernel != sha256_kernel::avx2_multi_buffer) {
+            SHA256 ctx{};
+            for (size_t i = 0; i < count; i++) {
+                ctx.init(kernel);
+                ctx.update(messages[i], lengths[i]);
+                ctx.final(digests + i * DIGEST_SIZE);
+            }
+            return;
+        }
+        if (!supported(kernel)) {
+            throw std::invalid_argument("SHA-256 kernel not supported by this CPU");
+        }
+#ifdef LITTLESMITH_SHA256_X86
+        const unsigned int LANES = 8;
+        struct lane {
+            size_t message;
+            const uint8_t *data;
+            size_t block_nb;
+            uint8_t tail[2 * SHA224_256_BLOCK_SIZE];
+            size_t tail_nb;
+            size_t tail_done;
+            bool active;
+        };
+        static const uint8_t idle[SHA224_256_BLOCK_SIZE] = {};
+        uint32_t state[8][LANES];
+        lane lanes[LANES];
+        size_t next = 0;
+        unsigned int active = 0;
+        auto start = [&](unsigned int l) {
+            auto &current = lanes[l];
+            current.active = next < count;
+            if (!current.active) {
+                return;
+            }
+            current.message = next++;
+            current.data = messages[current.message];
+            current.block_nb = lengths[current.message] / SHA224_256_BLOCK_SIZE;
+            current.tail_nb = pad(current.data + current.block_nb * SHA224_256_BLOCK_SIZE,
+                                  lengths[current.message] % SHA224_256_BLOCK_SIZE, lengths[current.message], current.tail);
+            current.tail_done = 0;
+            uint32_t h[8];
+            initState(h);
+            for (int j = 0; j < 8; j++) {
+                state[j][l] = h[j];
+            }
+            active++;
+        };
+        auto finish = [&](unsigned int l, const uint32_t *h) {
+            for (int j = 0; j < 8; j++) {
+                unpack(h[j], digests + lanes[l].message * DIGEST_SIZE + (j << 2));
+            }
+            active--;
+        };
+        for (unsigned int l = 0; l < LANES; l++) {
+            start(l);
+        }
+        // with less than half of the lanes busy, a single buffer kernel is faster
+        while (active >= LANES / 2 || (active > 0 && next < count)) {
+            const uint8_t *blocks[LANES];
+            for (unsigned int l = 0; l < LANES; l++) {
+                const auto &current = lanes[l];
+                blocks[l] = !current.active ? idle :
+                            current.block_nb > 0 ? current.data : current.tail + (current.tail_done << 6);
+            }
+            transformAvx2(state, blocks);
+            for (unsigned int l = 0; l < LANES; l++) {
+                auto &current = lanes[l];
+                if (!current.active) {
+                    continue;
+                }
+                if (current.block_nb > 0) {
+                    current.data += SHA224_256_BLOCK_SIZE;
+                    current.block_nb--;
+                } else if (++current.tail_done == current.tail_nb) {
+                    uint32_t h[8];
+                    for (int j = 0; j < 8; j++) {
+                        h[j] = state[j][l];
+                    }
+                    finish(l, h);
+                    start(l);
+                }
+            }
+        }
+        auto transform = function(best());
+        for (unsigned int l = 0; l < LANES; l++) {
+            auto &current = lanes[l];
+            if (!current.active) {
+                continue;
+            }
+            uint32_t h[8];
+            for (int j = 0; j < 8; j++) {
+                h[j] = state[j][l];
+            }
+            transform(h, current.data, current.block_nb);
+            transform(h, current.tail + (current.tail_done << 6), current.tail_nb - current.tail_done);
+            finish(l, h);
+        }
+#endif
+    }
+}
@@ -36,6 +36,8 @@ namespace littlesmith {
         std::string _description;
         argument_type _type;
         std::string _defaultValue;
+        std::string _implicitValue;
+        bool _hasImplicitValue{false};
         bool _switch;
         std::string _value;
         bool _optional;
@@ -55,6 +57,7 @@ namespace littlesmith {
         virtual ~argument() = default;
         void setValue(const std::string& value) { _value = value; _set = true; }
         void setDescription(const std::string &description) { _description = description; }
+        void setImplicitValue(const std::string& value) { _implicitValue = value; _hasImplicitValue = true; }
         template<typename T>
         T value() const;
         std::string longName() const { return _longName; }
@@ -64,6 +67,8 @@ namespace littlesmith {
         std::string defaultValue() const { return _defaultValue; }
         bool optional() const { return _optional; }
         bool isSwitch() const { return _switch; }
+        bool hasImplicitValue() const { return _hasImplicitValue; }
+        std::string implicitValue() const { return _implicitValue; }
         bool check();
         std::string toString() const;
     };
@@ -92,12 +97,13 @@ namespace littlesmith {
 
         void defineValue(const std::string& longName, const std::string& shortName, argument_type type, const std::string& defaultValue = "", bool optional = false);
         void defineSwitch(const std::string& longName, const std::string& shortName);
+        void defineImplicitValue(const std::string& longName, const std::string& shortName, argument_type type, const std::string& implicitValue, const std::string& defaultValue = "");
 
         void addDescription(const std::string& key, const std::string& description);
 
         template<typename T>
         T getValue(const std::string& key) { return _arguments.at(checkKey(key)).value<T>(); }
-        void printHeader();
+        void printHeader(std::ostream& out = std::cout);
         void printUsage();
 
     };
@@ -189,6 +195,10 @@ namespace littlesmith {
                     if (_arguments.at(key).isSwitch()) {
                         value = "true";
                         status = 3;
+                    } else if (status == 0 && _arguments.at(key).hasImplicitValue()) {
+                        // given without a value, e.g. --stats instead of --stats=json
+                        value = _arguments.at(key).implicitValue();
+                        status = 3;
                     }
                     if (status == 0) {
                         status = 1;
@@ -256,6 +266,12 @@ namespace littlesmith {
         _keys.emplace_back(shortName);
     }
 
+    inline void arguments::defineImplicitValue(const std::string& longName, const std::string& shortName, argument_type type,
+                                               const std::string& implicitValue, const std::string& defaultValue) {
+        defineValue(longName, shortName, type, defaultValue, true);
+        _arguments.at(shortName).setImplicitValue(implicitValue);
+    }
+
     inline void argument::checkType(argument_type type) const {
         if (_type != type) {
             throw std::invalid_argument("invalid type");
@@ -317,7 +333,9 @@ namespace littlesmith {
             ss << "[";
         }
         ss << "{-" << _shortName << "|--" << _longName << "}";
-        if (!_switch) {
+        if (_hasImplicitValue) {
+            ss << "[=" << _implicitValue << "]";
+        } else if (!_switch) {
             ss << "[=]";
             if (_optional) {
                 ss << _defaultValue;
@@ -349,19 +367,19 @@ namespace littlesmith {
         argument &arg = _arguments.at(checkKey(key));
         arg.setDescription(description);
     }
-    inline void arguments::printHeader() {
+    inline void arguments::printHeader(std::ostream& out) {
         if (_headerPrinted) return;
-        std::cout << _application << " " << _version.toString() << std::endl;
+        out << _application << " " << _version.toString() << std::endl;
         if (!_copyright.empty()) {
-            std::cout << _copyright << std::endl;
+            out << _copyright << std::endl;
         }
-        std::cout << std::endl;
+        out << std::endl;
         if (!_description.empty()) {
             auto lines = littlesmith::to_block(_description);
             for (const auto& line : lines) {
-                std::cout << line << std::endl;
+                out << line << std::endl;
             }
-            std::cout << std::endl;
+            out << std::endl;
         }
         _headerPrinted = true;
     }
@@ -0,0 +1,64 @@
+//
+// Created by stefan on 17.10.26.
+//
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace littlesmith {
+    /**
+     * @brief Calls function(index, worker) for every index in [0, count) on a pool of threads
+     *
+     * The indices are handed out one by one, so expensive items do not hold
+     * up a whole block of cheap ones. With one thread (or one item) everything
+     * runs in the calling thread in ascending order. The first exception
+     * thrown by the function stops the remaining work and is rethrown.
+     */
+    template <typename Function>
+    void parallel_for(size_t count, unsigned threads, Function&& function) {
+        if (threads <= 1 || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                function(i, 0u);
+            }
+            return;
+        }
+        if (threads > count) {
+            threads = static_cast<unsigned>(count);
+        }
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto work = [&](unsigned worker) {
+            size_t i;
+            while (!failed && (i = next.fetch_add(1)) < count) {
+                try {
+                    function(i, worker);
+                } catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned worker = 1; worker < threads; worker++) {
+            workers.emplace_back(work, worker);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,218 @@
+/**
+* @file io_uring_queue.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the io_uring_queue class.
+ *
+ * Minimal io_uring wrapper for batched metadata operations.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include "io_uring_queue.h"
+
+#ifdef MULTIRENAMER_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    int setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+    }
+
+    int register_probe(int fd, io_uring_probe* probe, unsigned ops) {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, ops));
+    }
+
+    bool supported(const io_uring_probe* probe, unsigned op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    void* map(int fd, size_t size, off_t offset) {
+        void* ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return ring == MAP_FAILED ? nullptr : ring;
+    }
+
+    template <typename T>
+    T* at(void* base, unsigned offset) {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+}
+
+io_uring_queue::io_uring_queue(unsigned entries) {
+    io_uring_params params{};
+    _fd = setup(entries, &params);
+    if (_fd < 0) {
+        _fd = -1;
+        return;
+    }
+    // renameat needs 5.11 and mkdirat 5.15, older kernels may still set up a ring
+    const unsigned probe_ops = 256;
+    std::vector<char> probe_buffer(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op), 0);
+    auto probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+    if (register_probe(_fd, probe, probe_ops) < 0 ||
+            !supported(probe, IORING_OP_RENAMEAT) || !supported(probe, IORING_OP_MKDIRAT)) {
+        close();
+        return;
+    }
+    _entries = params.sq_entries;
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+    _sq_ring = map(_fd, _sq_ring_size, IORING_OFF_SQ_RING);
+    if (_sq_ring != nullptr && (params.features & IORING_FEAT_SINGLE_MMAP)) {
+        _cq_ring = _sq_ring;
+    } else if (_sq_ring != nullptr) {
+        _cq_ring = map(_fd, _cq_ring_size, IORING_OFF_CQ_RING);
+    }
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = map(_fd, _sqes_size, IORING_OFF_SQES);
+    if (_sq_ring == nullptr || _cq_ring == nullptr || _sqes == nullptr) {
+        close();
+        return;
+    }
+    _sq_tail = at<unsigned>(_sq_ring, params.sq_off.tail);
+    _sq_mask = at<unsigned>(_sq_ring, params.sq_off.ring_mask);
+    _sq_array = at<unsigned>(_sq_ring, params.sq_off.array);
+    _cq_head = at<unsigned>(_cq_ring, params.cq_off.head);
+    _cq_tail = at<unsigned>(_cq_ring, params.cq_off.tail);
+    _cq_mask = at<unsigned>(_cq_ring, params.cq_off.ring_mask);
+    _cqes = at<void>(_cq_ring, params.cq_off.cqes);
+}
+
+io_uring_queue::~io_uring_queue() {
+    close();
+}
+
+void io_uring_queue::close() {
+    if (_sqes != nullptr) {
+        ::munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ring != nullptr && _cq_ring != _sq_ring) {
+        ::munmap(_cq_ring, _cq_ring_size);
+    }
+    if (_sq_ring != nullptr) {
+        ::munmap(_sq_ring, _sq_ring_size);
+    }
+    _sqes = _cq_ring = _sq_ring = nullptr;
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+    _fd = -1;
+}
+
+void* io_uring_queue::next_sqe() {
+    if (_fd < 0 || pending() >= _entries) {
+        return nullptr;
+    }
+    // only this thread writes the tail, the kernel reads it on io_uring_enter
+    unsigned tail = __atomic_load_n(_sq_tail, __ATOMIC_RELAXED) + _queued;
+    unsigned index = tail & *_sq_mask;
+    auto sqe = static_cast<io_uring_sqe*>(_sqes) + index;
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    _sq_array[index] = index;
+    _queued++;
+    return sqe;
+}
+
+bool io_uring_queue::rename(int old_directory, const char* old_name, int new_directory, const char* new_name,
+                            unsigned flags, uint64_t user_data) {
+    auto sqe = static_cast<io_uring_sqe*>(next_sqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RENAMEAT;
+    sqe->fd = old_directory;
+    sqe->addr = reinterpret_cast<uint64_t>(old_name);
+    sqe->len = static_cast<uint32_t>(new_directory);
+    sqe->addr2 = reinterpret_cast<uint64_t>(new_name);
+    sqe->rename_flags = flags;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool io_uring_queue::mkdir(int directory, const char* name, unsigned mode, uint64_t user_data) {
+    auto sqe = static_cast<io_uring_sqe*>(next_sqe());
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_MKDIRAT;
+    sqe->fd = directory;
+    sqe->addr = reinterpret_cast<uint64_t>(name);
+    sqe->len = mode;
+    sqe->user_data = user_data;
+    return true;
+}
+
+void io_uring_queue::submit(unsigned wait, std::vector<io_completion>& completions) {
+    if (_fd < 0) {
+        return;
+    }
+    unsigned submit = _queued;
+    if (submit > 0) {
+        __atomic_store_n(_sq_tail, __atomic_load_n(_sq_tail, __ATOMIC_RELAXED) + submit, __ATOMIC_RELEASE);
+        _queued = 0;
+        _in_flight += submit;
+    }
+    if (wait > _in_flight) {
+        wait = _in_flight;
+    }
+    while (submit > 0 || wait > 0) {
+        int n = enter(_fd, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::system_category(), "io_uring_enter");
+        }
+        submit -= std::min<unsigned>(submit, static_cast<unsigned>(n));
+        unsigned head = __atomic_load_n(_cq_head, __ATOMIC_RELAXED);
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        unsigned reaped = 0;
+        for (; head != tail; head++, reaped++) {
+            auto cqe = static_cast<io_uring_cqe*>(_cqes) + (head & *_cq_mask);
+            completions.push_back({cqe->user_data, cqe->res});
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+        _in_flight -= reaped;
+        wait -= std::min(wait, reaped);
+    }
+}
+
+#else
+
+io_uring_queue::io_uring_queue(unsigned) {
+}
+
+io_uring_queue::~io_uring_queue() = default;
+
+void io_uring_queue::close() {
+}
+
+void* io_uring_queue::next_sqe() {
+    return nullptr;
+}
+
+bool io_uring_queue::rename(int, const char*, int, const char*, unsigned, uint64_t) {
+    return false;
+}
+
+bool io_uring_queue::mkdir(int, const char*, unsigned, uint64_t) {
+    return false;
+}
+
+void io_uring_queue::submit(unsigned, std::vector<io_completion>&) {
+}
+
+#endif
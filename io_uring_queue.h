@@ -0,0 +1,114 @@
+/**
+* @file io_uring_queue.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the io_uring_queue class.
+ *
+ * Minimal io_uring wrapper for batched metadata operations.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MULTIRENAMER_HAVE_IO_URING 1
+#endif
+
+/**
+ * @brief A completed operation
+*/
+struct io_completion {
+    /** @brief The value passed when the operation was queued */
+    uint64_t user_data;
+    /** @brief The result, a negative errno on failure */
+    int32_t result;
+};
+
+/**
+ * @brief Submission and completion queue of an io_uring instance
+ *
+ * Talks to the kernel with the raw system calls, liburing is not needed.
+ * Only the operations multirenamer needs are offered. The strings passed
+ * to rename() and mkdir() only have to live until the next submit(),
+ * the kernel copies them when the operation is submitted.
+ *
+ * Not thread safe.
+*/
+class io_uring_queue {
+private:
+    int _fd{-1};
+    unsigned _entries{0};
+    unsigned _queued{0};
+    unsigned _in_flight{0};
+
+    void* _sq_ring{nullptr};
+    size_t _sq_ring_size{0};
+    void* _cq_ring{nullptr};
+    size_t _cq_ring_size{0};
+    void* _sqes{nullptr};
+    size_t _sqes_size{0};
+
+    unsigned* _sq_tail{nullptr};
+    unsigned* _sq_mask{nullptr};
+    unsigned* _sq_array{nullptr};
+    unsigned* _cq_head{nullptr};
+    unsigned* _cq_tail{nullptr};
+    unsigned* _cq_mask{nullptr};
+    void* _cqes{nullptr};
+
+    void* next_sqe();
+    void close();
+
+public:
+    /**
+     * @brief Constructor for the io_uring_queue
+     *
+     * Check available() afterwards, the kernel may not support io_uring or
+     * the operations needed.
+     *
+     * @param entries The queue depth
+    */
+    explicit io_uring_queue(unsigned entries);
+    io_uring_queue(const io_uring_queue&) = delete;
+    io_uring_queue& operator=(const io_uring_queue&) = delete;
+    ~io_uring_queue();
+
+    /**
+     * @brief True if the ring was set up and supports renameat and mkdirat
+    */
+    [[nodiscard]] bool available() const { return _fd >= 0; }
+
+    /**
+     * @brief The number of operations that can be queued or in flight at a time
+    */
+    [[nodiscard]] unsigned capacity() const { return _entries; }
+
+    /**
+     * @brief The number of operations queued or submitted and not completed yet
+    */
+    [[nodiscard]] unsigned pending() const { return _queued + _in_flight; }
+
+    /**
+     * @brief Queues a renameat2
+     *
+     * @returns false if the queue is full
+    */
+    bool rename(int old_directory, const char* old_name, int new_directory, const char* new_name,
+                unsigned flags, uint64_t user_data);
+
+    /**
+     * @brief Queues a mkdirat
+     *
+     * @returns false if the queue is full
+    */
+    bool mkdir(int directory, const char* name, unsigned mode, uint64_t user_data);
+
+    /**
+     * @brief Submits the queued operations and waits for completions
+     *
+     * @param wait The minimum number of completions to wait for
+     * @param completions Receives all available completions
+    */
+    void submit(unsigned wait, std::vector<io_completion>& completions);
+};
@@ -1,13 +1,16 @@
 #include <iostream>
 #include <littlesmith/util/Arguments.h>
 #include "multirenamer.h"
+#include "run_stats.h"
+#include "scan_filter.h"
 
 /**
- * @brief Enum for the 2 rename phases
+ * @brief Enum for the rename phases
 */
 enum class rename_phase {
     scan,
-    rename
+    rename,
+    undo
 };
 
 /**
@@ -30,7 +33,11 @@ int main(int argc, char* argv[]) {
     if (!arguments.parse(argc, argv)) {
        return -1;
     }
-    arguments.printHeader();
+    // when names are streamed through stdout, everything else goes to stderr
+    bool stream = arguments.getValue<bool>("stdout") || arguments.getValue<bool>("stdin") ||
+                  arguments.getValue<bool>("null");
+    std::ostream &out = stream ? std::cerr : std::cout;
+    arguments.printHeader(out);
     rename_phase phase;
 
     auto p = arguments.getValue<std::string>("path");
@@ -40,35 +47,143 @@ int main(int argc, char* argv[]) {
     } else {
         path.assign(p);
     }
-    if (arguments.getValue<bool>("scan")) {
+    auto pattern = arguments.getValue<std::string>("pattern");
+    if (arguments.getValue<bool>("undo")) {
+        if (arguments.getValue<bool>("scan") || arguments.getValue<bool>("rename") || arguments.getValue<bool>("resume") ||
+                stream || !pattern.empty() || !arguments.getValue<std::string>("delta").empty()) {
+            std::cerr << "--undo is not possible with --scan, --rename, --resume, --stdin, --pattern or --delta!" << std::endl;
+            return -1;
+        }
+        phase = rename_phase::undo;
+    } else if (arguments.getValue<bool>("scan")) {
         phase = rename_phase::scan;
-    } else if (arguments.getValue<bool>("rename")) {
+    } else if (arguments.getValue<bool>("rename") || arguments.getValue<bool>("resume") || !pattern.empty()) {
         phase = rename_phase::rename;
     } else {
-        std::cerr << "Please specify either --scan or --rename!" << std::endl;
+        std::cerr << "Please specify either --scan, --rename, --pattern or --undo!" << std::endl;
         arguments.printUsage();
         return -1;
     }
-    bool recursive = arguments.getValue<bool>("recursive");
+    auto threads = arguments.getValue<int>("threads");
+    if (threads < 1) {
+        std::cerr << "The number of threads must be at least 1!" << std::endl;
+        return -1;
+    }
+    rename_backend backend;
+    auto b = arguments.getValue<std::string>("backend");
+    if (b == "sync") {
+        backend = rename_backend::sync;
+    } else if (b == "io_uring") {
+        backend = rename_backend::io_uring;
+    } else {
+        std::cerr << "Unknown backend " << b << ", use sync or io_uring!" << std::endl;
+        return -1;
+    }
+    auto queueDepth = arguments.getValue<int>("queue-depth");
+    if (queueDepth < 1) {
+        std::cerr << "The queue depth must be at least 1!" << std::endl;
+        return -1;
+    }
+    auto hashThreads = arguments.getValue<int>("hash-threads");
+    if (hashThreads < 1) {
+        std::cerr << "The number of hash threads must be at least 1!" << std::endl;
+        return -1;
+    }
+    auto copyThreads = arguments.getValue<int>("copy-threads");
+    if (copyThreads < 1) {
+        std::cerr << "The number of copy threads must be at least 1!" << std::endl;
+        return -1;
+    }
+    auto copyBudget = arguments.getValue<int>("copy-budget");
+    if (copyBudget < 1) {
+        std::cerr << "The copy budget must be at least 1 MiB!" << std::endl;
+        return -1;
+    }
+    auto maxDepth = arguments.getValue<int>("max-depth");
+    if (maxDepth < 0) {
+        std::cerr << "The maximum depth must not be negative!" << std::endl;
+        return -1;
+    }
+    auto stats = arguments.getValue<std::string>("stats");
+    if (!stats.empty() && stats != "text" && stats != "json") {
+        std::cerr << "Unknown statistics format " << stats << ", use text or json!" << std::endl;
+        return -1;
+    }
+    if (arguments.getValue<bool>("stdout") && phase != rename_phase::scan) {
+        std::cerr << "--stdout is only possible with --scan!" << std::endl;
+        return -1;
+    }
+    if (arguments.getValue<bool>("stdin") && phase != rename_phase::rename) {
+        std::cerr << "--stdin is only possible with --rename!" << std::endl;
+        return -1;
+    }
+    if (stream && !arguments.getValue<std::string>("delta").empty()) {
+        std::cerr << "--delta is not possible with --stdin!" << std::endl;
+        return -1;
+    }
+    if (arguments.getValue<bool>("resume") && (phase != rename_phase::rename || stream || !pattern.empty())) {
+        std::cerr << "--resume is only possible with --rename, not with --scan, --stdin or --pattern!" << std::endl;
+        return -1;
+    }
+    if (phase == rename_phase::rename && !pattern.empty() &&
+            (stream || !arguments.getValue<std::string>("delta").empty())) {
+        std::cerr << "--pattern without --scan renames directly, it is not possible with --stdin or --delta!" << std::endl;
+        return -1;
+    }
+    auto delimiter = arguments.getValue<bool>("null") ? '\0' : '\n';
+    scan_options scanOptions;
+    scanOptions.recursive = arguments.getValue<bool>("recursive") || maxDepth > 0;
+    scanOptions.threads = threads;
+    scanOptions.index = arguments.getValue<bool>("index");
+    scanOptions.hash = arguments.getValue<bool>("hash");
+    scanOptions.hash_threads = hashThreads;
+    scanOptions.hash_cache = arguments.getValue<bool>("hash-cache");
+    scanOptions.to_stdout = stream;
+    scanOptions.delimiter = delimiter;
+    scanOptions.pattern = pattern;
+    scanOptions.include = scan_filter::split_list(arguments.getValue<std::string>("include"));
+    scanOptions.exclude = scan_filter::split_list(arguments.getValue<std::string>("exclude"));
+    scanOptions.max_depth = maxDepth;
+    scanOptions.newer_than = arguments.getValue<std::string>("newer-than");
+    scanOptions.follow_symlinks = arguments.getValue<bool>("follow-symlinks");
+    rename_options renameOptions;
+    renameOptions.threads = threads;
+    renameOptions.delta = arguments.getValue<std::string>("delta");
+    renameOptions.backend = backend;
+    renameOptions.queue_depth = queueDepth;
+    renameOptions.from_stdin = stream;
+    renameOptions.delimiter = delimiter;
+    renameOptions.resume = arguments.getValue<bool>("resume");
+    renameOptions.cross_device = arguments.getValue<bool>("cross-device");
+    renameOptions.copy_threads = copyThreads;
+    renameOptions.copy_budget = static_cast<uint64_t>(copyBudget) * 1024 * 1024;
 
     multirenamer renamer(path);
+    int result = 0;
     try {
         if (phase == rename_phase::scan) {
-            renamer.scan(recursive);
+            renamer.scan(scanOptions);
+        } else if (phase == rename_phase::undo) {
+            renamer.undo(renameOptions);
+        } else if (!pattern.empty()) {
+            renamer.scan_and_rename(scanOptions, renameOptions);
         } else {
-            renamer.rename();
+            renamer.rename(renameOptions);
         }
         if (renamer.error()) {
-            std::cout << "Some renames failed. See log." << std::endl;
+            out << "Some renames failed. See log." << std::endl;
         } else {
-            std::cout << "Everything was renamed successfully." << std::endl;
+            out << "Everything was renamed successfully." << std::endl;
         }
     } catch(std::runtime_error& ex) {
         std::cerr << "Error while renaming:" << std::endl;
         std::cerr << ex.what() << std::endl;
-        return -1;
+        result = -1;
+    }
+    if (!stats.empty()) {
+        run_stats::instance().print(out, stats == "json");
     }
-    return 0;
+    return result;
 }
 
 void initialize(littlesmith::arguments& arguments) {
@@ -80,9 +195,56 @@ void initialize(littlesmith::arguments& arguments) {
     arguments.defineSwitch("rename", "r");
     arguments.addDescription("rename", "Perform the rename on a directory");
 
+    arguments.defineSwitch("undo", "U");
+    arguments.addDescription("undo", "Revert the renames recorded in multirenamer_renamed.txt by the last rename and remove the directories it created if they are empty");
+    arguments.defineSwitch("resume", "C");
+    arguments.addDescription("resume", "Continue an interrupted rename, the renames it recorded as done are skipped. Implies --rename");
+
     arguments.defineValue("path", "p", littlesmith::argument_type::STRING, "", true);
     arguments.addDescription("path", "The path to scan for _files to rename. If omitted, the current directory will be used");
     arguments.defineSwitch("recursive", "R");
     arguments.addDescription("recursive", "Files in subdirectories will also be renamed (only relevant with --scan)");
+    arguments.defineSwitch("follow-symlinks", "L");
+    arguments.addDescription("follow-symlinks", "Also scan the directories symlinks point to, every directory only once even if several links lead to it (only relevant with --recursive)");
+    arguments.defineValue("include", "n", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("include", "Comma separated glob patterns, only matching files are listed, e.g. *.jpg,*.png (only relevant with --scan or --pattern)");
+    arguments.defineValue("exclude", "x", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("exclude", "Comma separated glob patterns of files and directories to skip, excluded directories are not read at all, e.g. .git,node_modules,*.tmp (only relevant with --scan or --pattern)");
+    arguments.defineValue("max-depth", "m", littlesmith::argument_type::INT, "0", true);
+    arguments.addDescription("max-depth", "The number of directory levels to read, 1 is only the path itself, 0 is unlimited. Implies --recursive (only relevant with --scan or --pattern)");
+    arguments.defineValue("newer-than", "N", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("newer-than", "Only list files modified after this time: an age like 7d, 12h or 30m, a date like 2024-05-01[T13:30] or the path of a file (only relevant with --scan or --pattern)");
+    arguments.defineValue("threads", "t", littlesmith::argument_type::INT, "1", true);
+    arguments.addDescription("threads", "The number of threads used to read directories or to execute the renames");
+    arguments.defineValue("delta", "d", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("delta", "Read only the changes from this file: a unified diff against multirenamer.txt or lines of the form line-number<TAB>new-name (only relevant with --rename)");
+    arguments.defineSwitch("index", "i");
+    arguments.addDescription("index", "Keep an index of the scanned directories and only read directories that changed since the last indexed scan (only relevant with --scan)");
+    arguments.defineSwitch("hash", "H");
+    arguments.addDescription("hash", "Append the SHA-256 of every file to its line in multirenamer.txt, separated by a tab. The column is ignored by --rename (only relevant with --scan)");
+    arguments.defineValue("hash-threads", "T", littlesmith::argument_type::INT, "16", true);
+    arguments.addDescription("hash-threads", "The number of files read and hashed at the same time with --hash (only relevant with --scan)");
+    arguments.defineSwitch("hash-cache", "c");
+    arguments.addDescription("hash-cache", "Keep the digests in a cache and only read files that are new or modified since they were hashed (only relevant with --hash)");
+    arguments.defineValue("backend", "b", littlesmith::argument_type::STRING, "sync", true);
+    arguments.addDescription("backend", "How the renames are executed: sync or io_uring, which falls back to sync if the kernel does not support it (only relevant with --rename)");
+    arguments.defineValue("queue-depth", "q", littlesmith::argument_type::INT, "256", true);
+    arguments.addDescription("queue-depth", "The maximum number of operations in flight with --backend=io_uring (only relevant with --rename)");
+    arguments.defineSwitch("cross-device", "X");
+    arguments.addDescription("cross-device", "Move files whose new name is on another filesystem by copying them with their metadata and removing the original once the copy is synced (only relevant with --rename or --undo)");
+    arguments.defineValue("copy-threads", "k", littlesmith::argument_type::INT, "8", true);
+    arguments.addDescription("copy-threads", "The number of files copied at the same time with --cross-device");
+    arguments.defineValue("copy-budget", "B", littlesmith::argument_type::INT, "256", true);
+    arguments.addDescription("copy-budget", "The number of MiB being copied at the same time with --cross-device, a larger file is copied alone");
+    arguments.defineImplicitValue("stats", "S", littlesmith::argument_type::STRING, "text");
+    arguments.addDescription("stats", "Print counters, wall time per phase and peak memory at the end, --stats=json prints them as JSON");
+    arguments.defineValue("pattern", "P", littlesmith::argument_type::STRING, "", true);
+    arguments.addDescription("pattern", "A substitution s/regex/replacement/flags (flags g and i) applied to every scanned name. With --scan, multirenamer.txt contains the new names, otherwise the files are scanned and renamed at once");
+    arguments.defineSwitch("stdout", "O");
+    arguments.addDescription("stdout", "Write the names to stdout instead of multirenamer.txt, all messages go to stderr (only relevant with --scan)");
+    arguments.defineSwitch("stdin", "I");
+    arguments.addDescription("stdin", "Read the new names from stdin instead of multirenamer.txt and rename them while they arrive (only relevant with --rename)");
+    arguments.defineSwitch("null", "0");
+    arguments.addDescription("null", "Names are separated by NUL instead of a line feed, for names that contain line feeds. Implies --stdout with --scan and --stdin with --rename");
 
 }
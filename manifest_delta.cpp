@@ -0,0 +1,199 @@
+/**
+* @file manifest_delta.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations for rename deltas.
+ *
+ * A delta describes only the changed lines of the rename file.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <littlesmith/util/Exceptions.h>
+#include "manifest_delta.h"
+#include "manifest_reader.h"
+
+namespace {
+    /**
+     * @brief Splits a string into lines like manifest_reader does
+    */
+    class line_splitter {
+    private:
+        const char* _position;
+        const char* _end;
+        size_t _line{0};
+    public:
+        explicit line_splitter(std::string_view content) : _position(content.data()), _end(content.data() + content.size()) {}
+
+        bool next(std::string_view& line) {
+            if (_position >= _end) {
+                return false;
+            }
+            auto delimiter = find_delimiter(_position, _end, '\n');
+            line = std::string_view(_position, delimiter - _position);
+            _position = delimiter < _end ? delimiter + 1 : _end;
+            _line++;
+            return true;
+        }
+
+        [[nodiscard]] size_t line() const { return _line; }
+    };
+
+    bool parse_number(std::string_view text, size_t& value) {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc() && end == text.data() + text.size() && !text.empty();
+    }
+
+    /**
+     * @brief Parses the "-a,b" or "+c,d" part of a hunk header, only the start is needed
+    */
+    bool parse_range(std::string_view text, size_t& start) {
+        auto comma = text.find(',');
+        return parse_number(text.substr(0, comma), start);
+    }
+
+    std::vector<delta_change> parse_unified(std::string_view content) {
+        std::vector<delta_change> changes;
+        line_splitter lines(content);
+        std::string_view line;
+        std::vector<std::pair<size_t, std::string_view>> removed;
+        std::vector<std::string_view> added;
+        size_t old_line = 0;
+        bool in_hunk = false;
+        auto flush = [&](size_t at) {
+            if (removed.size() != added.size()) {
+                throw littlesmith::formatException<std::runtime_error>(
+                        "Delta line %zu: %zu lines removed but %zu added, lines can only be replaced",
+                        at, removed.size(), added.size());
+            }
+            for (size_t i = 0; i < removed.size(); i++) {
+                changes.push_back({removed[i].first, added[i], removed[i].second});
+            }
+            removed.clear();
+            added.clear();
+        };
+        while (lines.next(line)) {
+            if (line.starts_with("@@")) {
+                flush(lines.line());
+                // @@ -a,b +c,d @@
+                auto end = line.find(' ', 3);
+                if (line.size() < 4 || line[3] != '-' || end == std::string_view::npos ||
+                        !parse_range(line.substr(4, end - 4), old_line)) {
+                    throw littlesmith::formatException<std::runtime_error>("Delta line %zu: bad hunk header", lines.line());
+                }
+                in_hunk = true;
+                continue;
+            }
+            if (!in_hunk || line.starts_with('\\')) {
+                // file headers and "\ No newline at end of file"
+                continue;
+            }
+            if (line.starts_with('-')) {
+                if (!added.empty()) {
+                    flush(lines.line());
+                }
+                removed.emplace_back(old_line++, line.substr(1));
+            } else if (line.starts_with('+')) {
+                added.push_back(line.substr(1));
+            } else if (line.starts_with(' ') || line.empty()) {
+                flush(lines.line());
+                old_line++;
+            } else {
+                // anything else ends the hunk (e.g. the next "diff --git" header)
+                flush(lines.line());
+                in_hunk = false;
+            }
+        }
+        flush(lines.line());
+        return changes;
+    }
+
+    std::vector<delta_change> parse_sparse(std::string_view content) {
+        std::vector<delta_change> changes;
+        line_splitter lines(content);
+        std::string_view line;
+        while (lines.next(line)) {
+            if (line.empty()) {
+                continue;
+            }
+            auto tab = line.find('\t');
+            size_t number;
+            if (tab == std::string_view::npos || !parse_number(line.substr(0, tab), number) || number == 0) {
+                throw littlesmith::formatException<std::runtime_error>(
+                        "Delta line %zu: expected line-number<TAB>new-name", lines.line());
+            }
+            changes.push_back({number, line.substr(tab + 1), {}});
+        }
+        return changes;
+    }
+}
+
+std::vector<delta_change> parse_delta(std::string_view content) {
+    // a unified diff starts with its headers or a hunk, a sparse delta with a digit
+    auto first = content.substr(0, content.find('\n'));
+    bool unified = first.starts_with("--- ") || first.starts_with("diff ") || first.starts_with("@@") ||
+                   first.starts_with("Index: ");
+    auto changes = unified ? parse_unified(content) : parse_sparse(content);
+    std::stable_sort(changes.begin(), changes.end(), [](const auto &a, const auto &b) { return a.line < b.line; });
+    for (size_t i = 1; i < changes.size(); i++) {
+        if (changes[i].line == changes[i - 1].line) {
+            throw littlesmith::formatException<std::runtime_error>("Delta changes line %zu twice", changes[i].line);
+        }
+    }
+    return changes;
+}
+
+line_locator::line_locator(std::string_view content, const std::filesystem::path &checkpoints) :
+    _content(content), _interval(CHECKPOINT_INTERVAL) {
+    std::ifstream in(checkpoints, std::ios::binary);
+    if (in) {
+        in.seekg(0, std::ios::end);
+        auto size = static_cast<size_t>(in.tellg());
+        in.seekg(0);
+        _checkpoints.resize(size / sizeof(uint64_t));
+        in.read(reinterpret_cast<char *>(_checkpoints.data()), static_cast<std::streamsize>(_checkpoints.size() * sizeof(uint64_t)));
+        if (!in || (!_checkpoints.empty() && _checkpoints[0] != 0) ||
+                (!_checkpoints.empty() && _checkpoints.back() > content.size())) {
+            _checkpoints.clear();
+        }
+    }
+    if (_checkpoints.empty()) {
+        // no usable checkpoints, split once and remember every line
+        _interval = 1;
+        line_splitter lines(content);
+        std::string_view line;
+        while (lines.next(line)) {
+            _checkpoints.push_back(static_cast<uint64_t>(line.data() - content.data()));
+        }
+    }
+}
+
+bool line_locator::find(size_t line, std::string_view &result) const {
+    if (line == 0) {
+        return false;
+    }
+    auto checkpoint = (line - 1) / _interval;
+    if (checkpoint >= _checkpoints.size()) {
+        return false;
+    }
+    line_splitter lines(_content.substr(_checkpoints[checkpoint]));
+    for (size_t skip = (line - 1) % _interval; skip > 0; skip--) {
+        if (!lines.next(result)) {
+            return false;
+        }
+    }
+    return lines.next(result);
+}
+
+void line_locator::write(const std::filesystem::path &path, const std::vector<uint64_t> &checkpoints) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(checkpoints.data()), static_cast<std::streamsize>(checkpoints.size() * sizeof(uint64_t)));
+    if (!out) {
+        throw std::filesystem::filesystem_error("Could not write line checkpoints", path,
+                                                std::make_error_code(std::errc::io_error));
+    }
+}
@@ -0,0 +1,87 @@
+/**
+* @file manifest_delta.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definitions for rename deltas.
+ *
+ * A delta describes only the changed lines of the rename file.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A changed line of the rename file
+*/
+struct delta_change {
+    /** @brief The line in the manifests (1 based) */
+    size_t line;
+    /** @brief The new name */
+    std::string_view name;
+    /** @brief The old name according to the delta, empty if the delta does not say */
+    std::string_view expected;
+};
+
+/**
+ * @brief Parses a delta
+ *
+ * Two formats are understood:
+ * - a unified diff of the scanned multirenamer.txt against the edited one
+ *   (diff -u, git diff). Lines may only be replaced, never added or
+ *   removed, so every block of removed lines must be followed by the same
+ *   number of added lines.
+ * - a sparse list with one "line-number<TAB>new-name" per line.
+ *
+ * @param content The delta, the changes refer into it
+ * @returns The changes, ordered by line
+*/
+std::vector<delta_change> parse_delta(std::string_view content);
+
+/**
+ * @brief Finds lines in a manifest by number without splitting all of it
+ *
+ * Uses the checkpoints written during the scan (the offset of every
+ * CHECKPOINT_INTERVAL-th line), so finding a line costs at most
+ * CHECKPOINT_INTERVAL line scans. Without checkpoints the whole manifest
+ * is split once.
+*/
+class line_locator {
+public:
+    /** @brief Number of lines between two checkpoints */
+    static const size_t CHECKPOINT_INTERVAL = 1024;
+
+private:
+    std::string_view _content;
+    std::vector<uint64_t> _checkpoints;
+    size_t _interval;
+
+public:
+    /**
+     * @brief Constructor for the line_locator
+     *
+     * @param content The manifest
+     * @param checkpoints The checkpoint file of the manifest, ignored if it does not exist
+    */
+    line_locator(std::string_view content, const std::filesystem::path& checkpoints);
+
+    /**
+     * @brief Returns a line of the manifest
+     *
+     * @param line The line number (1 based)
+     * @param result Receives the line without line feed
+     * @returns false if the manifest has fewer lines
+    */
+    bool find(size_t line, std::string_view& result) const;
+
+    /**
+     * @brief Writes the checkpoint file for a manifest
+     *
+     * @param path The checkpoint file
+     * @param checkpoints The offset of every CHECKPOINT_INTERVAL-th line, starting with line 1
+    */
+    static void write(const std::filesystem::path& path, const std::vector<uint64_t>& checkpoints);
+};
@@ -0,0 +1,222 @@
+/**
+* @file manifest_reader.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the manifest_reader class.
+ *
+ * Reads the line based manifests of multirenamer from a memory mapping.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MULTIRENAMER_X86 1
+#endif
+
+#include "manifest_reader.h"
+
+namespace {
+    const char* find_scalar(const char* begin, const char* end, char delimiter) {
+        while (begin < end && *begin != delimiter) {
+            begin++;
+        }
+        return begin;
+    }
+
+#ifdef MULTIRENAMER_X86
+    __attribute__((target("sse2")))
+    const char* find_sse2(const char* begin, const char* end, char delimiter) {
+        const __m128i needle = _mm_set1_epi8(delimiter);
+        while (end - begin >= 16) {
+            auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+            auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+            if (mask != 0) {
+                return begin + __builtin_ctz(mask);
+            }
+            begin += 16;
+        }
+        return find_scalar(begin, end, delimiter);
+    }
+
+    __attribute__((target("avx2")))
+    const char* find_avx2(const char* begin, const char* end, char delimiter) {
+        const __m256i needle = _mm256_set1_epi8(delimiter);
+        // two vectors per round, names in manifests are usually longer than 32 bytes
+        while (end - begin >= 64) {
+            auto a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin)), needle);
+            auto b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + 32)), needle);
+            if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))) {
+                auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(a));
+                if (mask != 0) {
+                    return begin + __builtin_ctz(mask);
+                }
+                return begin + 32 + __builtin_ctz(static_cast<uint32_t>(_mm256_movemask_epi8(b)));
+            }
+            begin += 64;
+        }
+        while (end - begin >= 32) {
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin)), needle)));
+            if (mask != 0) {
+                return begin + __builtin_ctz(mask);
+            }
+            begin += 32;
+        }
+        return find_sse2(begin, end, delimiter);
+    }
+#endif
+
+    using find_function = const char* (*)(const char*, const char*, char);
+
+    find_function select_find() {
+#ifdef MULTIRENAMER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return find_avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return find_sse2;
+        }
+#endif
+        return find_scalar;
+    }
+
+    const find_function find_implementation = select_find();
+}
+
+const char* find_delimiter(const char* begin, const char* end, char delimiter) {
+    return find_implementation(begin, end, delimiter);
+}
+
+manifest_reader::manifest_reader(const std::filesystem::path &path, char delimiter) : _path(path), _delimiter(delimiter) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::filesystem::filesystem_error("Could not open manifest", path,
+                                                std::error_code(errno, std::system_category()));
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        auto error = errno;
+        ::close(fd);
+        throw std::filesystem::filesystem_error("Could not open manifest", path,
+                                                std::error_code(error, std::system_category()));
+    }
+    _size = static_cast<size_t>(st.st_size);
+    if (_size > 0) {
+        void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            auto error = errno;
+            ::close(fd);
+            throw std::filesystem::filesystem_error("Could not map manifest", path,
+                                                    std::error_code(error, std::system_category()));
+        }
+        ::madvise(data, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(data);
+    }
+    ::close(fd);
+    _position = _data;
+}
+
+manifest_reader::~manifest_reader() {
+    if (_data != nullptr) {
+        ::munmap(const_cast<char *>(_data), _size);
+    }
+}
+
+bool manifest_reader::next(std::string_view &line) {
+    const char *end = _data + _size;
+    if (_position == nullptr || _position >= end) {
+        return false;
+    }
+    const char *delimiter = find_delimiter(_position, end, _delimiter);
+    line = std::string_view(_position, delimiter - _position);
+    _position = delimiter < end ? delimiter + 1 : end;
+    _line++;
+    return true;
+}
+
+record_reader::record_reader(int fd, std::string name, char delimiter, size_t buffer_size) :
+    _name(std::move(name)), _fd(fd), _delimiter(delimiter), _buffer(std::max<size_t>(buffer_size, 4096)) {
+}
+
+record_reader::record_reader(const std::filesystem::path &path, char delimiter, size_t buffer_size) :
+    _name(path.string()), _owned(true), _delimiter(delimiter), _buffer(std::max<size_t>(buffer_size, 4096)) {
+    _fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd < 0) {
+        throw std::filesystem::filesystem_error("Could not open manifest", path,
+                                                std::error_code(errno, std::system_category()));
+    }
+}
+
+record_reader::~record_reader() {
+    if (_owned) {
+        ::close(_fd);
+    }
+}
+
+bool record_reader::fill() {
+    if (_begin > 0) {
+        // the views handed out before are invalid from here on
+        std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+        _end -= _begin;
+        _begin = 0;
+    }
+    if (_end == _buffer.size()) {
+        _buffer.resize(_buffer.size() * 2);
+    }
+    while (true) {
+        auto n = ::read(_fd, _buffer.data() + _end, _buffer.size() - _end);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::filesystem::filesystem_error("Could not read", _name,
+                                                    std::error_code(errno, std::system_category()));
+        }
+        _end += static_cast<size_t>(n);
+        return n > 0;
+    }
+}
+
+bool record_reader::next(std::string_view &record) {
+    size_t searched = _begin;
+    while (true) {
+        const char *begin = _buffer.data() + _begin;
+        const char *delimiter = find_delimiter(_buffer.data() + searched, _buffer.data() + _end, _delimiter);
+        if (delimiter < _buffer.data() + _end) {
+            record = std::string_view(begin, delimiter - begin);
+            _begin = delimiter - _buffer.data() + 1;
+            _record++;
+            return true;
+        }
+        auto pending = _end - _begin;
+        bool more = fill();
+        searched = _begin + pending;
+        if (!more) {
+            if (_end == _begin) {
+                return false;
+            }
+            record = std::string_view(_buffer.data() + _begin, _end - _begin);
+            _begin = _end;
+            _record++;
+            return true;
+        }
+    }
+}
+
+bool record_reader::ready() const {
+    if (find_delimiter(_buffer.data() + _begin, _buffer.data() + _end, _delimiter) < _buffer.data() + _end) {
+        return true;
+    }
+    pollfd fd{_fd, POLLIN, 0};
+    return ::poll(&fd, 1, 0) > 0;
+}
@@ -0,0 +1,157 @@
+/**
+* @file manifest_reader.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the manifest_reader class.
+ *
+ * Reads the line based manifests of multirenamer from a memory mapping.
+ */
+
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Finds the first occurrence of a delimiter
+ *
+ * Uses AVX2 or SSE2 when the CPU supports it and a scalar loop otherwise.
+ * The implementation is selected once at startup.
+ *
+ * @param begin The first character to search
+ * @param end One past the last character to search
+ * @param delimiter The character to search for
+ * @returns Pointer to the delimiter, or end if there is none
+*/
+const char* find_delimiter(const char* begin, const char* end, char delimiter);
+
+/**
+ * @brief Reads a manifest line by line without copying
+ *
+ * The whole file is mapped into memory and the lines are handed out as
+ * string_views into the mapping. They stay valid as long as the reader
+ * exists. Like std::getline, a missing line feed after the last line is
+ * fine and no other characters are stripped. Instead of the line feed,
+ * another delimiter such as NUL can separate the lines.
+*/
+class manifest_reader {
+private:
+    std::filesystem::path _path;
+    const char* _data{nullptr};
+    size_t _size{0};
+    const char* _position{nullptr};
+    size_t _line{0};
+    char _delimiter;
+
+public:
+    /**
+     * @brief Constructor for the manifest_reader, maps the file
+     *
+     * @param path The file to read
+     * @param delimiter The character that ends a line
+    */
+    explicit manifest_reader(const std::filesystem::path& path, char delimiter = '\n');
+    manifest_reader(const manifest_reader&) = delete;
+    manifest_reader& operator=(const manifest_reader&) = delete;
+    ~manifest_reader();
+
+    /**
+     * @brief Reads the next line
+     *
+     * @param line Receives the line without the delimiter
+     * @returns false if there are no more lines
+    */
+    bool next(std::string_view& line);
+
+    /**
+     * @brief The number of lines read so far
+    */
+    [[nodiscard]] size_t line() const { return _line; }
+
+    /**
+     * @brief The whole content of the file
+    */
+    [[nodiscard]] std::string_view content() const { return {_data, _size}; }
+};
+
+/**
+ * @brief Reads delimited records from a file descriptor as they arrive
+ *
+ * Unlike manifest_reader, the input does not have to be complete: a pipe
+ * is read while the writer is still producing, a file while it is still
+ * growing. Records are read into a buffer that grows to the longest
+ * record, so the memory used does not depend on the size of the input.
+ *
+ * A read that returns no data ends the input only for the current call to
+ * next(), a later call tries again. For a pipe that is the same, for a
+ * file that is still written it means that the records written later can
+ * be read later.
+*/
+class record_reader {
+public:
+    /** @brief Default size of the read buffer */
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+private:
+    std::string _name;
+    int _fd{-1};
+    bool _owned{false};
+    char _delimiter;
+    std::vector<char> _buffer;
+    size_t _begin{0};
+    size_t _end{0};
+    size_t _record{0};
+
+    bool fill();
+
+public:
+    /**
+     * @brief Constructor for a record_reader on an open file, e.g. a pipe
+     *
+     * The descriptor is not closed by the reader.
+     *
+     * @param fd The file descriptor, e.g. STDIN_FILENO
+     * @param name The name used in error messages
+     * @param delimiter The character that ends a record
+     * @param buffer_size The initial size of the read buffer
+    */
+    record_reader(int fd, std::string name, char delimiter = '\n', size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * @brief Constructor for a record_reader, opens the file
+     *
+     * @param path The file to read
+     * @param delimiter The character that ends a record
+     * @param buffer_size The initial size of the read buffer
+    */
+    explicit record_reader(const std::filesystem::path& path, char delimiter = '\n',
+                           size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    record_reader(const record_reader&) = delete;
+    record_reader& operator=(const record_reader&) = delete;
+    ~record_reader();
+
+    /**
+     * @brief Reads the next record, waits for it if necessary
+     *
+     * At the end of the input, the rest after the last delimiter is
+     * returned as a record of its own if it is not empty.
+     *
+     * @param record Receives the record without the delimiter, valid until the next call
+     * @returns false if there are no more records
+    */
+    bool next(std::string_view& record);
+
+    /**
+     * @brief Checks whether next() can return without waiting
+     *
+     * @returns true if a complete record is buffered or the descriptor has data or is at its end
+    */
+    [[nodiscard]] bool ready() const;
+
+    /**
+     * @brief The number of records read so far
+    */
+    [[nodiscard]] size_t record() const { return _record; }
+};
@@ -0,0 +1,267 @@
+/**
+* @file manifest_writer.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the manifest_writer class.
+ *
+ * Writes the line based manifests of multirenamer in large blocks.
+ */
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "manifest_writer.h"
+#include "probes.h"
+
+namespace {
+    const size_t PAGE_SIZE = 4096;
+    /** @brief Filled buffers collected before they are written with one writev */
+    const size_t BUFFERS_PER_WRITE = 8;
+    /** @brief Buffers allowed to exist in background mode before the producer waits */
+    const size_t MAX_BUFFERS = 4 * BUFFERS_PER_WRITE;
+}
+
+manifest_writer::manifest_writer(const std::filesystem::path &path, bool background, size_t buffer_size, char delimiter) :
+    _path(path), _delimiter(delimiter), _buffer_size((buffer_size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE),
+    _background(background) {
+    if (_buffer_size == 0) {
+        _buffer_size = DEFAULT_BUFFER_SIZE;
+    }
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (_fd < 0) {
+        throw std::filesystem::filesystem_error("Could not open manifest", path,
+                                                std::error_code(errno, std::system_category()));
+    }
+    _current = acquire();
+    if (_background) {
+        _thread = std::thread(&manifest_writer::run, this);
+    }
+}
+
+manifest_writer::manifest_writer(int fd, const std::string &name, size_t buffer_size, char delimiter) :
+    _path(name), _fd(fd), _owned(false), _delimiter(delimiter),
+    _buffer_size((buffer_size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE), _background(false) {
+    if (_buffer_size == 0) {
+        _buffer_size = DEFAULT_BUFFER_SIZE;
+    }
+    _current = acquire();
+}
+
+manifest_writer::~manifest_writer() {
+    try {
+        close();
+    } catch (...) {
+        // destructors must not throw, call close() to see write errors
+    }
+    std::free(_current.data);
+    for (auto &b: _free) {
+        std::free(b.data);
+    }
+}
+
+void manifest_writer::write(std::string_view line) {
+    MULTIRENAMER_PROBE2(manifest__line, line.data(), line.size());
+    while (_current.size + line.size() + 1 > _buffer_size) {
+        if (_current.size == 0) {
+            // a line longer than a whole buffer, give it a buffer of its own
+            std::free(_current.data);
+            _current.data = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, (line.size() + PAGE_SIZE) / PAGE_SIZE * PAGE_SIZE));
+            if (_current.data == nullptr) {
+                throw std::bad_alloc();
+            }
+            break;
+        }
+        auto n = std::min(line.size(), _buffer_size - _current.size);
+        std::memcpy(_current.data + _current.size, line.data(), n);
+        _current.size += n;
+        line.remove_prefix(n);
+        _bytes += n;
+        submit();
+    }
+    std::memcpy(_current.data + _current.size, line.data(), line.size());
+    _current.size += line.size();
+    _current.data[_current.size++] = _delimiter;
+    _bytes += line.size() + 1;
+    // a full buffer, and above all one of its own for a long line, must not take the next line
+    if (_current.size >= _buffer_size) {
+        submit();
+    }
+}
+
+void manifest_writer::flush() {
+    if (_fd < 0) {
+        return;
+    }
+    if (_current.size > 0) {
+        submit();
+    }
+    if (!_filled.empty()) {
+        if (_background) {
+            std::unique_lock lock(_mutex);
+            _queue.emplace_back(std::move(_filled));
+            _cv.notify_all();
+        } else {
+            write_all(_filled);
+        }
+        _filled.clear();
+    }
+    if (_background) {
+        std::unique_lock lock(_mutex);
+        _cv.wait(lock, [this] { return _queue.empty() || _error; });
+    }
+    check();
+}
+
+void manifest_writer::sync() {
+    flush();
+    if (_fd >= 0 && _owned && ::fdatasync(_fd) != 0) {
+        throw std::filesystem::filesystem_error("Could not sync manifest", _path,
+                                                std::error_code(errno, std::system_category()));
+    }
+}
+
+void manifest_writer::close() {
+    if (_fd < 0) {
+        return;
+    }
+    std::exception_ptr error;
+    try {
+        flush();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (_thread.joinable()) {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+    if (_owned && ::close(_fd) != 0 && !error) {
+        error = std::make_exception_ptr(std::filesystem::filesystem_error("Could not close manifest", _path,
+                                        std::error_code(errno, std::system_category())));
+    }
+    _fd = -1;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+manifest_writer::buffer manifest_writer::acquire() {
+    std::unique_lock lock(_mutex);
+    if (_background) {
+        _cv.wait(lock, [this] { return !_free.empty() || _buffers < MAX_BUFFERS || _error; });
+    }
+    check();
+    if (!_free.empty()) {
+        auto b = _free.back();
+        _free.pop_back();
+        return b;
+    }
+    buffer b;
+    b.data = static_cast<char *>(std::aligned_alloc(PAGE_SIZE, _buffer_size));
+    if (b.data == nullptr) {
+        throw std::bad_alloc();
+    }
+    _buffers++;
+    return b;
+}
+
+void manifest_writer::submit() {
+    _filled.push_back(_current);
+    _current = buffer{};
+    if (_filled.size() >= BUFFERS_PER_WRITE) {
+        if (_background) {
+            std::lock_guard lock(_mutex);
+            _queue.emplace_back(std::move(_filled));
+            _cv.notify_all();
+        } else {
+            write_all(_filled);
+        }
+        _filled.clear();
+    }
+    _current = acquire();
+}
+
+void manifest_writer::write_all(std::vector<buffer> &buffers) {
+    std::vector<iovec> iov;
+    iov.reserve(buffers.size());
+    for (auto &b: buffers) {
+        if (b.size > 0) {
+            iov.push_back({b.data, b.size});
+        }
+    }
+    size_t first = 0;
+    while (first < iov.size()) {
+        auto count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        auto n = ::writev(_fd, iov.data() + first, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::filesystem::filesystem_error("Could not write manifest", _path,
+                                                    std::error_code(errno, std::system_category()));
+        }
+        // skip what was written, a short write continues in the middle of a buffer
+        auto written = static_cast<size_t>(n);
+        while (first < iov.size() && written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (written > 0) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    std::lock_guard lock(_mutex);
+    for (auto &b: buffers) {
+        if (b.size > _buffer_size) {
+            // oversized buffer for a single long line
+            std::free(b.data);
+            _buffers--;
+            continue;
+        }
+        b.size = 0;
+        _free.push_back(b);
+    }
+}
+
+void manifest_writer::run() {
+    std::unique_lock lock(_mutex);
+    while (true) {
+        _cv.wait(lock, [this] { return !_queue.empty() || _stop; });
+        if (_queue.empty()) {
+            break;
+        }
+        auto buffers = std::move(_queue.front());
+        lock.unlock();
+        try {
+            write_all(buffers);
+        } catch (...) {
+            for (auto &b: buffers) {
+                std::free(b.data);
+            }
+            lock.lock();
+            _error = std::current_exception();
+            _queue.clear();
+            _cv.notify_all();
+            break;
+        }
+        lock.lock();
+        _queue.pop_front();
+        _cv.notify_all();
+    }
+}
+
+void manifest_writer::check() {
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
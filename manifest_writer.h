@@ -0,0 +1,129 @@
+/**
+* @file manifest_writer.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the manifest_writer class.
+ *
+ * Writes the line based manifests of multirenamer in large blocks.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Buffered writer for manifest files
+ *
+ * Lines are collected in page aligned buffers. Filled buffers are written
+ * together with a single writev call, either directly by the caller or by
+ * a background thread so that the caller can go on producing lines. Only
+ * sync() makes the data durable; there is no flush per line.
+ *
+ * Records are separated by a line feed by default, or by another delimiter
+ * such as NUL for names that contain line feeds.
+ *
+ * The writer itself is not thread safe, one producer at a time.
+*/
+class manifest_writer {
+public:
+    /** @brief Default size of a single buffer */
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+private:
+    struct buffer {
+        char* data{nullptr};
+        size_t size{0};
+    };
+
+    std::filesystem::path _path;
+    int _fd{-1};
+    bool _owned{true};
+    char _delimiter{'\n'};
+    size_t _buffer_size;
+    bool _background;
+    uint64_t _bytes{0};
+
+    buffer _current;
+    std::vector<buffer> _filled;
+    std::vector<buffer> _free;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::vector<buffer>> _queue;
+    size_t _buffers{0};
+    bool _stop{false};
+    std::exception_ptr _error;
+
+    buffer acquire();
+    void submit();
+    void write_all(std::vector<buffer>& buffers);
+    void run();
+    void check();
+
+public:
+    /**
+     * @brief Constructor for the manifest_writer, creates or truncates the file
+     *
+     * @param path The file to write
+     * @param background If true, the blocks are written by a background thread
+     * @param buffer_size The size of a single buffer, rounded up to whole pages
+     * @param delimiter The character written after every record
+    */
+    explicit manifest_writer(const std::filesystem::path& path, bool background = false,
+                             size_t buffer_size = DEFAULT_BUFFER_SIZE, char delimiter = '\n');
+
+    /**
+     * @brief Constructor for a manifest_writer on an open file, e.g. a pipe
+     *
+     * The descriptor is not closed by the writer and sync() only flushes.
+     *
+     * @param fd The file descriptor, e.g. STDOUT_FILENO
+     * @param name The name used in error messages
+     * @param buffer_size The size of a single buffer, rounded up to whole pages
+     * @param delimiter The character written after every record
+    */
+    manifest_writer(int fd, const std::string& name, size_t buffer_size, char delimiter = '\n');
+    manifest_writer(const manifest_writer&) = delete;
+    manifest_writer& operator=(const manifest_writer&) = delete;
+
+    /**
+     * @brief Destructor, writes pending lines and closes the file without syncing it
+    */
+    ~manifest_writer();
+
+    /**
+     * @brief Appends a line, the delimiter is added by the writer
+     *
+     * @param line The line without delimiter
+    */
+    void write(std::string_view line);
+
+    /**
+     * @brief Writes all buffered lines to the file
+    */
+    void flush();
+
+    /**
+     * @brief Writes all buffered lines and waits until they are on stable storage
+    */
+    void sync();
+
+    /**
+     * @brief Flushes and closes the file, further writes are not allowed
+    */
+    void close();
+
+    /**
+     * @brief The number of bytes written to the writer so far
+    */
+    [[nodiscard]] uint64_t bytes() const { return _bytes; }
+};
@@ -7,92 +7,774 @@
  * Provides functionality for multiple renaming of files
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <list>
 #include <vector>
-#include <stack>
+#include <memory>
+#include <mutex>
 #include <fstream>
+#include <iostream>
+#include <deque>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "multirenamer.h"
+#include "directory_walker.h"
+#include "scan_index.h"
+#include "manifest_writer.h"
+#include "manifest_reader.h"
+#include "rename_executor.h"
+#include "rename_journal.h"
+#include "manifest_delta.h"
+#include "content_hasher.h"
+#include "name_pattern.h"
+#include "probes.h"
+#include "run_stats.h"
 #include <littlesmith/crypto/SHA256.h>
+#include <littlesmith/util/Exceptions.h>
+
+namespace {
+    /** @brief Buffer size for stdout, smaller than for files so the next process in the pipeline gets names early */
+    const size_t STREAM_BUFFER_SIZE = 64 * 1024;
+    /** @brief The maximum number of renames of a chunk read from stdin */
+    const size_t STREAM_CHUNK_SIZE = 16384;
+    /** @brief The number of renames a chunk needs to be closed early because stdin has nothing more yet */
+    const size_t STREAM_MIN_CHUNK_SIZE = 256;
+    /** @brief The time after which a chunk is closed early because stdin has nothing more yet, however small it is */
+    const std::chrono::milliseconds STREAM_CHUNK_DELAY{100};
+    /** @brief The maximum number of renames held back for names further down the stream */
+    const size_t STREAM_HOLD_LIMIT = 65536;
+
+    /**
+     * @brief A streamed rename waiting for its new name to be renamed away by a later line
+    */
+    struct held_rename {
+        size_t line;
+        std::string from;
+        std::string to;
+    };
+
+    /**
+     * @brief Takes the operations out of a chunk that have to wait for names further down the stream
+     *
+     * An operation whose new name exists and is not renamed away within the
+     * chunk may be waiting for a later line, like the next link of a chain or
+     * the other half of a swap. It is held back, and so is every operation
+     * renaming into its old name.
+     *
+     * @param operations The chunk, the held back operations are removed
+     * @param held Receives the held back operations in their order
+    */
+    void hold_back(std::vector<rename_operation> &operations, std::vector<rename_operation> &held) {
+        std::unordered_map<std::string_view, size_t> sources;
+        std::unordered_multimap<std::string_view, size_t> targets;
+        for (size_t i = 0; i < operations.size(); i++) {
+            sources.emplace(operations[i].from, i);
+            targets.emplace(operations[i].to, i);
+        }
+        std::vector<bool> hold(operations.size(), false);
+        std::vector<size_t> pending;
+        struct stat st{};
+        for (size_t i = 0; i < operations.size(); i++) {
+            if (!sources.contains(operations[i].to) && ::lstat(std::string(operations[i].to).c_str(), &st) == 0) {
+                hold[i] = true;
+                pending.push_back(i);
+            }
+        }
+        while (!pending.empty()) {
+            auto i = pending.back();
+            pending.pop_back();
+            auto [first, last] = targets.equal_range(operations[i].from);
+            for (; first != last; ++first) {
+                if (!hold[first->second]) {
+                    hold[first->second] = true;
+                    pending.push_back(first->second);
+                }
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < operations.size(); i++) {
+            if (hold[i]) {
+                held.push_back(operations[i]);
+            } else {
+                operations[kept++] = operations[i];
+            }
+        }
+        operations.resize(kept);
+    }
+}
 
 multirenamer::multirenamer(const std::filesystem::path &path)  :
-    _path(path), _rename_txt(path), _old_name_txt(std::filesystem::temp_directory_path()) {
-    _old_name_txt.append(".multirenamer_name_list_" + littlesmith::SHA256::hashString(path) + ".txt");
+    _path(path), _rename_txt(path), _old_name_txt(std::filesystem::temp_directory_path()),
+    _scan_index(std::filesystem::temp_directory_path()), _hash_cache(std::filesystem::temp_directory_path()) {
+    auto hash = littlesmith::SHA256::hashString(path);
+    _old_name_txt.append(".multirenamer_name_list_" + hash + ".txt");
+    _old_name_nul = _old_name_txt;
+    _old_name_nul.replace_extension(".nul");
+    _old_name_lines = _old_name_txt;
+    _old_name_lines.replace_extension(".lines");
+    _old_name_hashed = _old_name_txt;
+    _old_name_hashed.replace_extension(".hashed");
+    _renamed_txt = path;
+    _renamed_txt.append("multirenamer_renamed.txt");
+    _journal = _old_name_txt;
+    _journal.replace_extension(".journal");
+    _scan_index.append(".multirenamer_scan_index_" + hash + ".bin");
     _rename_txt.append("multirenamer.txt");
+    // the digests do not depend on the scanned path, all scans share one cache
+    _hash_cache.append(".multirenamer_hash_cache.bin");
 }
 
-void multirenamer::scan(bool recursive) {
-    std::stack<std::filesystem::path> stack;
-    stack.push(_path);
-
-    std::ofstream rename(_rename_txt);
-    std::ofstream old_name(_old_name_txt);
-    while (!stack.empty()) {
-        auto current = stack.top();
-        stack.pop();
-        for (auto const &entry: std::filesystem::directory_iterator(current, std::filesystem::directory_options::skip_permission_denied)) {
-            if (entry.is_regular_file()) {
-                if (entry.path().filename() != _rename_txt.filename() &&
-                        entry.path().filename() != _old_name_txt.filename()) {
-                    auto name = entry.path().string();
-                    if (name.starts_with('"') && name.ends_with('"')) {
-                        name = name.substr(1, name.length() - 2);
-                    }
-                    rename << name << std::endl;
-                    old_name << name << std::endl;
-                }
+const std::filesystem::path &multirenamer::old_name_list(char delimiter) const {
+    // a rename must never pair names with a list of the other format
+    return delimiter == '\n' ? _old_name_txt : _old_name_nul;
+}
+
+std::vector<std::string> multirenamer::select(std::vector<std::string> &files,
+                                              const std::filesystem::path &old_name_list) const {
+    std::vector<std::string> selected;
+    selected.reserve(files.size());
+    for (auto &name: files) {
+        auto filename = std::filesystem::path(name).filename();
+        if (filename != _rename_txt.filename() && filename != old_name_list.filename()) {
+            if (name.starts_with('"') && name.ends_with('"')) {
+                name = name.substr(1, name.length() - 2);
+            }
+            selected.push_back(std::move(name));
+        }
+    }
+    return selected;
+}
+
+std::unique_ptr<scan_filter> multirenamer::filter(const scan_options &options) {
+    if (options.include.empty() && options.exclude.empty() && options.max_depth == 0 && options.newer_than.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<scan_filter>(options.include, options.exclude, options.max_depth, options.newer_than);
+}
+
+void multirenamer::scan(const scan_options &options) {
+    auto filter = multirenamer::filter(options);
+    std::unique_ptr<name_pattern> pattern;
+    if (!options.pattern.empty()) {
+        pattern = std::make_unique<name_pattern>(options.pattern);
+    }
+    const auto &oldNameTxt = old_name_list(options.delimiter);
+    std::filesystem::remove(&oldNameTxt == &_old_name_txt ? _old_name_nul : _old_name_txt);
+    // a new scan is a new plan, an interrupted rename of the old one cannot be resumed
+    std::filesystem::remove(_journal);
+    // before the old name list, so a rename reading the pipe knows about the digests once the list exists
+    std::filesystem::remove(_old_name_hashed);
+    if (options.hash && !std::ofstream(_old_name_hashed)) {
+        throw std::filesystem::filesystem_error("Could not mark the old name list as hashed", _old_name_hashed,
+                                                std::make_error_code(std::errc::io_error));
+    }
+    std::unique_ptr<manifest_writer> rename;
+    if (options.to_stdout) {
+        // a rename of an earlier scan must not pair its names with the new old name list
+        std::filesystem::remove(_rename_txt);
+        rename = std::make_unique<manifest_writer>(STDOUT_FILENO, "stdout", STREAM_BUFFER_SIZE, options.delimiter);
+    } else {
+        // a parallel walk produces lines fast enough to keep a writer thread per manifest busy
+        rename = std::make_unique<manifest_writer>(_rename_txt, options.threads > 1,
+                                                   manifest_writer::DEFAULT_BUFFER_SIZE, options.delimiter);
+    }
+    manifest_writer old_name(oldNameTxt, options.threads > 1 && !options.to_stdout,
+                             manifest_writer::DEFAULT_BUFFER_SIZE, options.delimiter);
+    std::mutex output;
+    std::vector<uint64_t> checkpoints;
+    size_t lines = 0;
+    std::unique_ptr<scan_index> index;
+    if (options.index) {
+        index = std::make_unique<scan_index>(_scan_index);
+    }
+    // writes the lines of one directory to both manifests, digests is null without --hash
+    auto emit = [&](std::vector<std::string> &files, const std::vector<std::string> *digests) {
+        // substituted on the calling thread, outside of the lock
+        std::vector<std::string> edited;
+        if (pattern) {
+            pattern->substitute(files, edited);
+        }
+        const auto &names = pattern ? edited : files;
+        std::lock_guard lock(output);
+        for (const auto &file: files) {
+            if (lines++ % line_locator::CHECKPOINT_INTERVAL == 0) {
+                checkpoints.push_back(old_name.bytes());
             }
-            if (entry.is_directory() && recursive) {
-                stack.push(entry.path());
+            old_name.write(file);
+        }
+        if (options.to_stdout) {
+            // the old names have to be in the list before the names reach the pipe, see rename_stream
+            old_name.flush();
+        }
+        for (size_t i = 0; i < files.size(); i++) {
+            if (digests != nullptr && !(*digests)[i].empty()) {
+                rename->write(names[i] + '\t' + (*digests)[i]);
+            } else {
+                rename->write(names[i]);
             }
         }
+    };
+    std::unique_ptr<hash_cache> cache;
+    std::unique_ptr<content_hasher> hasher;
+    if (options.hash) {
+        if (options.hash_cache) {
+            cache = std::make_unique<hash_cache>(_hash_cache);
+        }
+        hasher = std::make_unique<content_hasher>(options.hash_threads,
+                [&](std::vector<std::string> &files, const std::vector<std::string> &digests) {
+            emit(files, &digests);
+        }, cache.get());
+    }
+    directory_walker walker(options.recursive, options.threads,
+                            [&](const std::filesystem::path &, std::vector<std::string> &files) {
+        auto selected = select(files, oldNameTxt);
+        if (hasher) {
+            hasher->submit(std::move(selected));
+        } else {
+            emit(selected, nullptr);
+        }
+    }, index.get(), filter.get(), options.follow_symlinks);
+    phase_timer scanTimer("scan");
+    walker.walk(_path);
+    if (hasher) {
+        hasher->finish();
+    }
+    scanTimer.stop();
+    if (cache) {
+        phase_timer cacheTimer("hash_cache_save");
+        cache->close();
+    }
+    phase_timer flushTimer("manifest_write");
+    rename->sync();
+    old_name.sync();
+    rename->close();
+    old_name.close();
+    line_locator::write(_old_name_lines, checkpoints);
+    flushTimer.stop();
+    run_stats::instance().bytes_written += rename->bytes() + old_name.bytes() + checkpoints.size() * sizeof(uint64_t);
+    if (index) {
+        phase_timer indexTimer("index_save");
+        index->save();
     }
 }
 
-void multirenamer::rename() {
-    if (!std::filesystem::exists(_rename_txt)) {
+void multirenamer::rename(const rename_options &options) {
+    if (options.from_stdin) {
+        rename_stream(options);
+        return;
+    }
+    const auto &oldNameTxt = old_name_list(options.delimiter);
+    if (options.delta.empty() && !std::filesystem::exists(_rename_txt)) {
         throw std::runtime_error("No rename file found on this path!");
     }
-    if (!std::filesystem::exists(_old_name_txt)) {
+    if (!options.delta.empty() && !std::filesystem::exists(options.delta)) {
+        throw std::runtime_error("Delta file not found!");
+    }
+    if (!std::filesystem::exists(oldNameTxt)) {
         throw std::runtime_error("No old name file found on this path!");
     }
-    std::ifstream rename(_rename_txt);
-    std::ifstream old_name(_old_name_txt);
-    std::string newName, oldName;
+    phase_timer planTimer("plan");
+    manifest_reader old_name(oldNameTxt, options.delimiter);
+    manifest_reader rename(options.delta.empty() ? _rename_txt : options.delta, options.delimiter);
+    run_stats::instance().bytes_read += old_name.content().size() + rename.content().size();
     auto log_path = _path;
     log_path.append("multirenamer_error.log");
     if (std::filesystem::exists(log_path)) {
         std::filesystem::remove(log_path);
     }
+    // only a scan with --hash wrote a digest column, a name may end like one by itself
+    bool hashed = std::filesystem::exists(_old_name_hashed);
+    auto strip = [hashed](std::string_view line) { return hashed ? strip_hash_column(line) : line; };
+    std::vector<rename_operation> operations;
+    if (options.delta.empty()) {
+        std::string_view newName, oldName;
+        while (old_name.next(oldName)) {
+            if (!rename.next(newName)) {
+                throw std::runtime_error("Could not read new name from rename file!");
+            }
+            newName = strip(newName);
+            if (oldName != newName) {
+                operations.push_back({old_name.line(), oldName, newName});
+            }
+        }
+    } else {
+        // only the changed lines are looked up in the old name list
+        line_locator locator(old_name.content(), _old_name_lines);
+        for (const auto &change: parse_delta(rename.content())) {
+            std::string_view oldName;
+            if (!locator.find(change.line, oldName)) {
+                throw littlesmith::formatException<std::runtime_error>("Delta refers to line %zu, which was not scanned!", change.line);
+            }
+            if (!change.expected.empty() && strip(change.expected) != oldName) {
+                throw littlesmith::formatException<std::runtime_error>("Delta does not match the scan in line %zu!", change.line);
+            }
+            auto newName = strip(change.name);
+            if (oldName != newName) {
+                operations.push_back({change.line, oldName, newName});
+            }
+        }
+    }
+    // the journal records indices into the plan as ordered here
+    rename_planner planner;
+    plan_renames(planner, operations, log_path);
+    if (!options.resume && std::filesystem::exists(_journal)) {
+        throw littlesmith::formatException<std::runtime_error>(
+                "A rename on this path was interrupted, continue it with --resume or delete %s!", _journal.c_str());
+    }
+    std::vector<bool> completed;
+    rename_journal journal(_journal, rename_journal::fingerprint(operations), operations.size(),
+                           options.resume ? &completed : nullptr);
+    // when resuming, only the operations the journal does not record, with their index in the full plan
+    std::vector<rename_operation> pending;
+    std::vector<size_t> indices;
+    if (options.resume) {
+        for (size_t i = 0; i < operations.size(); i++) {
+            if (!completed[i]) {
+                pending.push_back(operations[i]);
+                indices.push_back(i);
+            }
+        }
+    } else {
+        pending = operations;
+    }
+    // the journal still records the renames of the files in a directory moved as a whole
+    plan_compressor compressor;
+    compress(compressor, pending);
+    planTimer.stop();
+    rename_executor executor(options.threads, options.backend, options.queue_depth);
+    rename_executor::completion_callback journaled = [&](size_t i) {
+        compressor.expand(i, [&](size_t file) {
+            journal.complete(options.resume ? indices[file] : file);
+        });
+    };
+    auto failures = executor.execute(pending, journaled);
+    move_across_devices(options, pending, failures, journaled);
+    if (options.resume) {
+        // renames executed just before the interruption, whose records were not committed yet
+        std::erase_if(failures, [&](const rename_failure &failure) {
+            const auto &operation = pending[failure.operation];
+            return !std::filesystem::exists(std::filesystem::symlink_status(operation.from)) &&
+                   std::filesystem::exists(std::filesystem::symlink_status(operation.to));
+        });
+    }
+    journal.close();
+    run_stats::instance().rename_failures += failures.size();
+    phase_timer logTimer("log");
+    if (executor.backend() != options.backend) {
+        std::cerr << "io_uring is not available, the renames were executed synchronously." << std::endl;
+    }
+
     std::ofstream log_file;
     _logged = false;
-    while (std::getline(old_name, oldName)) {
-        if (!std::getline(rename, newName)) {
-            throw std::runtime_error("Could not read new name from rename file!");
+    log_failures(log_file, log_path, pending, failures);
+    if (_logged) {
+        log_file.close();
+    }
+    {
+        manifest_writer renamed(_renamed_txt, false, manifest_writer::DEFAULT_BUFFER_SIZE, options.delimiter);
+        if (options.resume) {
+            // the renames done before the interruption come first, in the order they were executed
+            std::vector<rename_operation> done;
+            for (size_t i = 0; i < operations.size(); i++) {
+                if (completed[i]) {
+                    done.push_back(operations[i]);
+                }
+            }
+            record_renames(renamed, done, {}, {});
+        }
+        record_renames(renamed, pending, failures, executor.created());
+        renamed.close();
+        run_stats::instance().bytes_written += renamed.bytes();
+    }
+    std::filesystem::remove(oldNameTxt);
+    std::filesystem::remove(_old_name_lines);
+    std::filesystem::remove(_old_name_hashed);
+    std::filesystem::remove(_rename_txt);
+    // last, so a crash before this point still refuses to rename the same plan again
+    std::filesystem::remove(_journal);
+}
+
+void multirenamer::record_renames(manifest_writer &renamed, const std::vector<rename_operation> &operations,
+                                  const std::vector<rename_failure> &failures,
+                                  const std::vector<std::string> &directories) {
+    for (const auto &directory: directories) {
+        renamed.write("d" + directory);
+    }
+    auto failure = failures.begin();
+    std::string record;
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (failure != failures.end() && failure->operation == i) {
+            ++failure;
+            continue;
+        }
+        record.assign("-").append(operations[i].from);
+        renamed.write(record);
+        record.assign("+").append(operations[i].to);
+        renamed.write(record);
+    }
+}
+
+void multirenamer::log_failures(std::ofstream &log_file, const std::filesystem::path &log_path,
+                                const std::vector<rename_operation> &operations,
+                                const std::vector<rename_failure> &failures) {
+    for (const auto &failure: failures) {
+        const auto &operation = operations[failure.operation];
+        MULTIRENAMER_PROBE2(error, operation.line, failure.message.c_str());
+        if (!_logged) {
+            log_file.open(log_path);
+            _logged = true;
+        }
+        log_file << "Failed to rename: " << std::endl;
+        log_file << "  " << operation.from << std::endl << " - " << operation.to << std::endl;
+        log_file << "  Error:" << failure.message << std::endl << std::endl;
+    }
+}
+
+void multirenamer::plan_renames(rename_planner &planner, std::vector<rename_operation> &operations,
+                                const std::filesystem::path &log_path, size_t executed) {
+    auto conflicts = planner.plan(operations);
+    if (conflicts.empty()) {
+        run_stats::instance().renames_reordered += planner.moved();
+        run_stats::instance().rename_cycles += planner.cycles();
+        return;
+    }
+    std::ofstream log_file(log_path, std::ios::app);
+    for (const auto &conflict: conflicts) {
+        MULTIRENAMER_PROBE2(error, conflict.second, conflict.same_source ? "Renamed twice" : "Same new name");
+        log_file << (conflict.same_source ? "Renamed twice: " : "Same new name: ") << std::endl;
+        log_file << "  " << conflict.path << std::endl;
+        log_file << "  Lines: " << conflict.first << ", " << conflict.second << std::endl << std::endl;
+    }
+    log_file.close();
+    if (executed > 0) {
+        throw littlesmith::formatException<std::runtime_error>(
+                "%zu renames conflict with others and were not executed, but %zu renames of earlier chunks were! "
+                "They are recorded in %s, revert them with --undo. See %s",
+                conflicts.size(), executed, _renamed_txt.c_str(), log_path.c_str());
+    }
+    throw littlesmith::formatException<std::runtime_error>(
+            "%zu renames conflict with others, none of the renames was executed! See %s",
+            conflicts.size(), log_path.c_str());
+}
+
+void multirenamer::compress(plan_compressor &compressor, std::vector<rename_operation> &operations) {
+    if (compressor.compress(operations)) {
+        run_stats::instance().renames_collapsed += compressor.collapsed();
+    }
+}
+
+void multirenamer::move_across_devices(const rename_options &options, const std::vector<rename_operation> &operations,
+                                       std::vector<rename_failure> &failures,
+                                       const rename_executor::completion_callback &callback) {
+    if (!options.cross_device) {
+        return;
+    }
+    phase_timer copyTimer("copy");
+    cross_device_mover mover(options.copy_threads, options.copy_budget);
+    mover.move(operations, failures, callback);
+}
+
+void multirenamer::rename_stream(const rename_options &options) {
+    const auto &oldNameTxt = old_name_list(options.delimiter);
+    auto log_path = _path;
+    log_path.append("multirenamer_error.log");
+    if (std::filesystem::exists(log_path)) {
+        std::filesystem::remove(log_path);
+    }
+    record_reader input(STDIN_FILENO, "stdin", options.delimiter);
+    // opened with the first name: the scan writing into the pipe may not have created the list before
+    std::unique_ptr<record_reader> old_name;
+    std::unique_ptr<manifest_writer> renamed;
+    rename_executor executor(options.threads, options.backend, options.queue_depth);
+    rename_planner planner;
+    // the operations refer to these names, a deque does not move them when it grows
+    std::deque<std::string> names;
+    std::vector<rename_operation> operations;
+    std::ofstream log_file;
+    _logged = false;
+    uint64_t bytes = 0;
+    // renames held back by earlier chunks, indexed by the new name they wait for
+    std::list<held_rename> held;
+    std::unordered_multimap<std::string_view, std::list<held_rename>::iterator> waiting;
+    std::vector<rename_operation> deferred;
+    size_t executed = 0;
+    auto release = [&](std::list<held_rename>::iterator it) {
+        const auto &from = names.emplace_back(std::move(it->from));
+        const auto &to = names.emplace_back(std::move(it->to));
+        operations.push_back({it->line, from, to});
+        held.erase(it);
+    };
+    // a held rename joins the chunk that renames its new name away, and so do the ones waiting for its old name
+    auto pull = [&] {
+        std::vector<std::list<held_rename>::iterator> released;
+        for (size_t i = 0; i < operations.size(); i++) {
+            auto [first, last] = waiting.equal_range(operations[i].from);
+            for (auto it = first; it != last; ++it) {
+                released.push_back(it->second);
+            }
+            waiting.erase(first, last);
+            for (auto it: released) {
+                release(it);
+            }
+            released.clear();
+        }
+    };
+    // with the last chunk, or when too many are held back, every held rename has to run
+    auto execute = [&](bool last) {
+        if (last) {
+            waiting.clear();
+            while (!held.empty()) {
+                release(held.begin());
+            }
+        } else {
+            pull();
+            hold_back(operations, deferred);
+        }
+        if (!operations.empty()) {
+            plan_renames(planner, operations, log_path, executed);
+            auto failures = executor.execute(operations);
+            move_across_devices(options, operations, failures);
+            run_stats::instance().rename_failures += failures.size();
+            log_failures(log_file, log_path, operations, failures);
+            record_renames(*renamed, operations, failures, executor.created());
+            executed += operations.size() - failures.size();
+        }
+        for (const auto &operation: deferred) {
+            auto it = held.insert(held.end(), {operation.line, std::string(operation.from), std::string(operation.to)});
+            waiting.emplace(it->to, it);
+        }
+        deferred.clear();
+        operations.clear();
+        names.clear();
+    };
+    auto chunkStart = std::chrono::steady_clock::now();
+    // known once the old name list exists, the scan marks it before
+    bool hashed = false;
+    std::string_view newName, oldName;
+    while (input.next(newName)) {
+        bytes += newName.size() + 1;
+        if (!old_name) {
+            if (!std::filesystem::exists(oldNameTxt)) {
+                throw std::runtime_error("No old name file found on this path!");
+            }
+            old_name = std::make_unique<record_reader>(oldNameTxt, options.delimiter);
+            renamed = std::make_unique<manifest_writer>(_renamed_txt, false, manifest_writer::DEFAULT_BUFFER_SIZE,
+                                                        options.delimiter);
+            hashed = std::filesystem::exists(_old_name_hashed);
+        }
+        if (hashed) {
+            newName = strip_hash_column(newName);
+        }
+        // the scan writes every name to the list before it writes it to the pipe
+        if (!old_name->next(oldName)) {
+            throw littlesmith::formatException<std::runtime_error>("The input has more names than were scanned (%zu)!",
+                                                                   old_name->record());
         }
         if (oldName != newName) {
-            try {
-                auto oldPath = std::filesystem::path(oldName).parent_path();
-                auto newPath = std::filesystem::path(newName).parent_path();
-                if (oldPath != newPath) {
-                    std::filesystem::create_directories(newPath);
-                }
-                std::filesystem::rename(oldName, newName);
-            } catch (std::filesystem::filesystem_error &ex) {
-                if (!_logged) {
-                    log_file.open(log_path);
-                    _logged = true;
-                }
-                log_file << "Failed to rename: " << std::endl;
-                log_file << "  " << oldName << std::endl << " - " << newName << std::endl;
-                log_file << "  Error:" << ex.what() << std::endl << std::endl;
+            if (operations.empty()) {
+                chunkStart = std::chrono::steady_clock::now();
             }
+            const auto &from = names.emplace_back(oldName);
+            const auto &to = names.emplace_back(newName);
+            operations.push_back({old_name->record(), from, to});
+        }
+        // rename what arrived so far before waiting for more, unless that is only a few names
+        if (operations.size() >= STREAM_CHUNK_SIZE ||
+                (!operations.empty() && !input.ready() && (operations.size() >= STREAM_MIN_CHUNK_SIZE ||
+                        std::chrono::steady_clock::now() - chunkStart >= STREAM_CHUNK_DELAY))) {
+            execute(false);
+        }
+        if (held.size() > STREAM_HOLD_LIMIT) {
+            if (!_logged) {
+                log_file.open(log_path);
+                _logged = true;
+            }
+            log_file << "Renamed without waiting for later lines: " << std::endl;
+            log_file << "  " << held.size() << " renames were held back, more than " << STREAM_HOLD_LIMIT
+                     << ", their new names may still exist" << std::endl << std::endl;
+            execute(true);
         }
     }
+    execute(true);
+    run_stats::instance().bytes_read += bytes;
     if (_logged) {
         log_file.close();
     }
-    std::filesystem::remove(_old_name_txt);
-    auto renamed_txt = std::filesystem::path(_path).append("multirenamer_renamed.txt");
-    std::filesystem::copy(_rename_txt, renamed_txt);
-    std::filesystem::remove(_rename_txt);
+    if (renamed) {
+        renamed->close();
+        run_stats::instance().bytes_written += renamed->bytes();
+    }
+    bool incomplete = old_name && old_name->next(oldName);
+    auto received = old_name ? old_name->record() - incomplete : 0;
+    std::filesystem::remove(oldNameTxt);
+    std::filesystem::remove(_old_name_lines);
+    std::filesystem::remove(_old_name_hashed);
+    if (incomplete) {
+        throw littlesmith::formatException<std::runtime_error>("The input ended after %zu names, the remaining files were not renamed!",
+                                                               received);
+    }
+}
+
+void multirenamer::scan_and_rename(const scan_options &scanOptions, const rename_options &renameOptions) {
+    if (scanOptions.pattern.empty()) {
+        throw std::runtime_error("No pattern given!");
+    }
+    name_pattern pattern(scanOptions.pattern);
+    auto filter = multirenamer::filter(scanOptions);
+    auto log_path = _path;
+    log_path.append("multirenamer_error.log");
+    if (std::filesystem::exists(log_path)) {
+        std::filesystem::remove(log_path);
+    }
+    std::unique_ptr<scan_index> index;
+    if (scanOptions.index) {
+        index = std::make_unique<scan_index>(_scan_index);
+    }
+    std::mutex output;
+    size_t lines = 0;
+    // the operations refer to these names, a deque does not move them when it grows
+    std::deque<std::string> names;
+    std::vector<rename_operation> operations;
+    // nothing is renamed before the walk is done, it would find the renamed files again
+    directory_walker walker(scanOptions.recursive, scanOptions.threads,
+                            [&](const std::filesystem::path &, std::vector<std::string> &files) {
+        auto selected = select(files, _old_name_txt);
+        std::vector<std::string> edited;
+        pattern.substitute(selected, edited);
+        std::lock_guard lock(output);
+        for (size_t i = 0; i < selected.size(); i++) {
+            lines++;
+            if (edited[i] != selected[i]) {
+                const auto &from = names.emplace_back(std::move(selected[i]));
+                const auto &to = names.emplace_back(std::move(edited[i]));
+                operations.push_back({lines, from, to});
+            }
+        }
+    }, index.get(), filter.get(), scanOptions.follow_symlinks);
+    phase_timer scanTimer("scan");
+    walker.walk(_path);
+    scanTimer.stop();
+    if (index) {
+        phase_timer indexTimer("index_save");
+        index->save();
+    }
+    rename_planner planner;
+    plan_renames(planner, operations, log_path);
+    plan_compressor compressor;
+    compress(compressor, operations);
+    rename_executor executor(renameOptions.threads, renameOptions.backend, renameOptions.queue_depth);
+    auto failures = executor.execute(operations);
+    move_across_devices(renameOptions, operations, failures);
+    run_stats::instance().rename_failures += failures.size();
+    phase_timer logTimer("log");
+    if (executor.backend() != renameOptions.backend) {
+        std::cerr << "io_uring is not available, the renames were executed synchronously." << std::endl;
+    }
+    std::ofstream log_file;
+    _logged = false;
+    log_failures(log_file, log_path, operations, failures);
+    if (_logged) {
+        log_file.close();
+    }
+    manifest_writer renamed(_renamed_txt);
+    record_renames(renamed, operations, failures, executor.created());
+    renamed.close();
+    run_stats::instance().bytes_written += renamed.bytes();
+}
+
+void multirenamer::undo(const rename_options &options) {
+    if (!std::filesystem::exists(_renamed_txt)) {
+        throw std::runtime_error("No record of a rename found on this path!");
+    }
+    phase_timer planTimer("plan");
+    // names cannot contain NUL, so a record containing one was written with --null
+    auto record = std::make_unique<manifest_reader>(_renamed_txt);
+    char delimiter = '\n';
+    if (record->content().find('\0') != std::string_view::npos) {
+        delimiter = '\0';
+        record = std::make_unique<manifest_reader>(_renamed_txt, delimiter);
+    }
+    run_stats::instance().bytes_read += record->content().size();
+    std::vector<std::string_view> directories;
+    std::vector<rename_operation> operations;
+    std::string_view line, from;
+    size_t fromLine = 0;
+    bool open = false;
+    while (record->next(line)) {
+        if (line.empty()) {
+            continue;
+        }
+        auto name = line.substr(1);
+        if (line[0] == 'd' && !open) {
+            directories.push_back(name);
+        } else if (line[0] == '-' && !open) {
+            from = name;
+            fromLine = record->line();
+            open = true;
+        } else if (line[0] == '+' && open) {
+            operations.push_back({fromLine, name, from});
+            open = false;
+        } else {
+            throw littlesmith::formatException<std::runtime_error>("The rename record is damaged in line %zu!",
+                                                                   record->line());
+        }
+    }
+    if (open) {
+        throw std::runtime_error("The rename record ends in the middle of a rename!");
+    }
+    // the last rename is undone first, so renames depending on each other are reverted in the right order
+    std::reverse(operations.begin(), operations.end());
+    planTimer.stop();
+    auto log_path = _path;
+    log_path.append("multirenamer_error.log");
+    if (std::filesystem::exists(log_path)) {
+        std::filesystem::remove(log_path);
+    }
+    rename_executor executor(options.threads, options.backend, options.queue_depth);
+    auto failures = executor.execute(operations);
+    move_across_devices(options, operations, failures);
+    run_stats::instance().rename_failures += failures.size();
+    phase_timer cleanupTimer("cleanup");
+    // the directories the rename created, children first, only if they are empty now
+    std::vector<std::string_view> remaining;
+    for (auto it = directories.rbegin(); it != directories.rend(); ++it) {
+        if (::rmdir(std::string(*it).c_str()) != 0 && errno != ENOENT) {
+            remaining.push_back(*it);
+        }
+    }
+    cleanupTimer.stop();
+    phase_timer logTimer("log");
+    if (executor.backend() != options.backend) {
+        std::cerr << "io_uring is not available, the renames were executed synchronously." << std::endl;
+    }
+    std::ofstream log_file;
+    _logged = false;
+    log_failures(log_file, log_path, operations, failures);
+    if (_logged) {
+        log_file.close();
+    }
+    if (failures.empty()) {
+        std::filesystem::remove(_renamed_txt);
+        return;
+    }
+    // what could not be undone stays in the record, so the undo can be repeated once the cause is fixed
+    auto temp = _renamed_txt;
+    temp += ".tmp";
+    {
+        manifest_writer renamed(temp, false, manifest_writer::DEFAULT_BUFFER_SIZE, delimiter);
+        std::vector<std::string> kept(remaining.rbegin(), remaining.rend());
+        std::vector<rename_operation> forward;
+        for (auto it = failures.rbegin(); it != failures.rend(); ++it) {
+            const auto &operation = operations[it->operation];
+            forward.push_back({operation.line, operation.to, operation.from});
+        }
+        record_renames(renamed, forward, {}, kept);
+        renamed.close();
+    }
+    std::filesystem::rename(temp, _renamed_txt);
 }
@@ -9,7 +9,79 @@
 
 
 #pragma once
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cross_device_mover.h"
+#include "manifest_writer.h"
+#include "rename_executor.h"
+#include "plan_compressor.h"
+#include "rename_planner.h"
+#include "scan_filter.h"
+
+/**
+ * @brief Options for the scan phase
+*/
+struct scan_options {
+    /** @brief If true, also scan subdirectories recursively */
+    bool recursive{false};
+    /** @brief The number of threads enumerating directories */
+    unsigned threads{1};
+    /** @brief If true, directories unchanged since the last indexed scan are not read again */
+    bool index{false};
+    /** @brief If true, the SHA-256 of every file is appended to its line of the rename file */
+    bool hash{false};
+    /** @brief The number of files hashed at the same time */
+    unsigned hash_threads{16};
+    /** @brief If true, digests are kept in a cache and only new or modified files are hashed */
+    bool hash_cache{false};
+    /** @brief If true, the names are written to stdout instead of the rename file */
+    bool to_stdout{false};
+    /** @brief The character that ends a name in the rename file or on stdout */
+    char delimiter{'\n'};
+    /** @brief If set, a substitution s/regex/replacement/flags applied to every name of the rename file, see name_pattern */
+    std::string pattern;
+    /** @brief Glob patterns of the files to list, all files if empty, see glob_set */
+    std::vector<std::string> include;
+    /** @brief Glob patterns of the files to skip and the directories not to read */
+    std::vector<std::string> exclude;
+    /** @brief The number of directory levels read with recursive, 1 is only the path itself, 0 is unlimited */
+    unsigned max_depth{0};
+    /** @brief If set, only files modified after this time are listed, see scan_filter::parse_time */
+    std::string newer_than;
+    /** @brief If true, symlinks to directories are walked too, every directory only once */
+    bool follow_symlinks{false};
+};
+
+/**
+ * @brief Options for the rename phase
+*/
+struct rename_options {
+    /** @brief The number of threads executing renames */
+    unsigned threads{1};
+    /** @brief If set, the changes are read from this delta instead of the rename file */
+    std::filesystem::path delta;
+    /** @brief How the renames are handed to the kernel */
+    rename_backend backend{rename_backend::sync};
+    /** @brief The maximum number of operations in flight with the io_uring backend */
+    unsigned queue_depth{256};
+    /** @brief If true, the new names are read from stdin while they arrive instead of the rename file */
+    bool from_stdin{false};
+    /** @brief The character that ends a name in the rename file or on stdin */
+    char delimiter{'\n'};
+    /** @brief If true, an interrupted rename is continued with the operations its journal does not record */
+    bool resume{false};
+    /** @brief If true, files that cannot be renamed because the new name is on another filesystem are copied */
+    bool cross_device{false};
+    /** @brief The number of files copied at the same time with cross_device */
+    unsigned copy_threads{cross_device_mover::DEFAULT_THREADS};
+    /** @brief The number of bytes being copied at the same time with cross_device */
+    uint64_t copy_budget{cross_device_mover::DEFAULT_BUDGET};
+};
 
 /**
  * @brief Class containing the implementation of multirenamer
@@ -23,11 +95,35 @@ class multirenamer {
 private:
     std::filesystem::path _path;
     std::filesystem::path _rename_txt;
+    std::filesystem::path _renamed_txt;
     std::filesystem::path _old_name_txt;
+    std::filesystem::path _old_name_nul;
+    std::filesystem::path _old_name_lines;
+    /** @brief Exists if the last scan appended a digest column to the rename file */
+    std::filesystem::path _old_name_hashed;
+    std::filesystem::path _journal;
+    std::filesystem::path _scan_index;
+    std::filesystem::path _hash_cache;
     bool _logged{false};
 
     std::vector<std::filesystem::path> _files;
 
+    [[nodiscard]] const std::filesystem::path& old_name_list(char delimiter) const;
+    [[nodiscard]] static std::unique_ptr<scan_filter> filter(const scan_options& options);
+    [[nodiscard]] std::vector<std::string> select(std::vector<std::string>& files,
+                                                  const std::filesystem::path& old_name_list) const;
+    static void record_renames(manifest_writer& renamed, const std::vector<rename_operation>& operations,
+                               const std::vector<rename_failure>& failures, const std::vector<std::string>& directories);
+    void log_failures(std::ofstream& log_file, const std::filesystem::path& log_path,
+                      const std::vector<rename_operation>& operations, const std::vector<rename_failure>& failures);
+    void plan_renames(rename_planner& planner, std::vector<rename_operation>& operations,
+                      const std::filesystem::path& log_path, size_t executed = 0);
+    static void compress(plan_compressor& compressor, std::vector<rename_operation>& operations);
+    static void move_across_devices(const rename_options& options, const std::vector<rename_operation>& operations,
+                                    std::vector<rename_failure>& failures,
+                                    const rename_executor::completion_callback& callback = nullptr);
+    void rename_stream(const rename_options& options);
+
 public:
     /**
      * @brief Constructor for the multirenamer
@@ -43,11 +139,64 @@ public:
     /**
      * @brief Scans the given path and writes the rename file
      *
-     * @param recursive If true, also scan subdirectories recursively.
+     * With more than one thread the lines are the same, but their order
+     * depends on which worker read a directory first.
+     *
+     * Excluded directories and directories deeper than max_depth are not
+     * read at all, see scan_filter.
+     *
+     * With to_stdout, the names are written to stdout instead, and every
+     * name is in the old name list before it is written, so a rename
+     * reading stdin in a pipeline can pair them as they arrive.
+     *
+     * @param options The options for the scan
     */
-    void scan(bool recursive);
+    void scan(const scan_options& options);
     /**
      * @brief Reads the rename file and performs the renaming and moving.
+     *
+     * Instead of the full rename file, a delta can be given (see
+     * parse_delta). Only the lines it changes are looked up in the old
+     * name list.
+     *
+     * With more than one thread the renames are split into shards by the
+     * directories they touch, see rename_executor.
+     *
+     * Every executed rename is recorded in a journal (see rename_journal),
+     * which is removed when the rename is done. If it still exists, the
+     * rename was interrupted and can only be continued with resume, which
+     * skips the operations the journal records.
+     *
+     * With from_stdin, the new names are read from stdin while the scan is
+     * still writing them. They are paired with the old name list as they
+     * arrive and renamed in chunks, whenever a chunk is full or no more
+     * input is available right now, so memory stays bounded and the
+     * renames start before the input ends.
+     *
+     * @param options The options for the rename
+    */
+    void rename(const rename_options& options);
+    /**
+     * @brief Scans the given path and renames the files with the pattern of the scan options
+     *
+     * Without the round trip through the rename file: the substitution is
+     * applied to every name on the threads of the scan, then the changed
+     * names are renamed like in rename.
+     *
+     * @param scanOptions The options for the scan, pattern must be set
+     * @param renameOptions The options for the rename
+    */
+    void scan_and_rename(const scan_options& scanOptions, const rename_options& renameOptions);
+    /**
+     * @brief Reverts the renames recorded in multirenamer_renamed.txt
+     *
+     * Every rename, rename from stdin and scan_and_rename records the
+     * directories it created and the old and new name of every successful
+     * rename. The undo executes the reverse renames in reverse order with
+     * the same rename_executor, then removes the recorded directories that
+     * are empty again. Renames that cannot be undone stay in the record.
+     *
+     * @param options The options for the rename, only threads, backend and queue_depth are used
     */
-    void rename();
+    void undo(const rename_options& options);
 };
@@ -0,0 +1,874 @@
+/**
+* @file name_pattern.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the name_pattern class.
+ *
+ * Applies sed style substitutions to the scanned names without backtracking.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <littlesmith/util/Exceptions.h>
+#include "name_pattern.h"
+
+namespace {
+    using char_class = std::array<uint64_t, 4>;
+
+    /** @brief The DFA of a matcher is dropped and built again when it has more states */
+    const size_t MAX_DFA_STATES = 4096;
+    /** @brief Marks a transition of the DFA that was not built yet */
+    const int32_t UNKNOWN = -1;
+    /** @brief Limit for n and m in {n,m} */
+    const int MAX_REPEAT = 1000;
+
+    void set(char_class &c, uint8_t character) {
+        c[character >> 6] |= uint64_t(1) << (character & 63);
+    }
+
+    bool test(const char_class &c, uint8_t character) {
+        return (c[character >> 6] >> (character & 63)) & 1;
+    }
+
+    void set_range(char_class &c, uint8_t first, uint8_t last) {
+        for (unsigned character = first; character <= last; character++) {
+            set(c, static_cast<uint8_t>(character));
+        }
+    }
+
+    void unite(char_class &c, const char_class &other) {
+        for (size_t i = 0; i < c.size(); i++) {
+            c[i] |= other[i];
+        }
+    }
+
+    char_class negate(const char_class &c) {
+        return {~c[0], ~c[1], ~c[2], ~c[3]};
+    }
+
+    void fold_case(char_class &c) {
+        for (unsigned character = 'a'; character <= 'z'; character++) {
+            auto upper = static_cast<uint8_t>(character - 'a' + 'A');
+            if (test(c, static_cast<uint8_t>(character)) || test(c, upper)) {
+                set(c, static_cast<uint8_t>(character));
+                set(c, upper);
+            }
+        }
+    }
+
+    /**
+     * @brief A node of the syntax tree of a regular expression
+    */
+    struct regex_node {
+        enum kind_type {
+            empty,
+            character_class,
+            concatenation,
+            alternation,
+            repetition,
+            group,
+            begin,
+            end
+        };
+        kind_type kind{empty};
+        char_class characters{};
+        std::vector<regex_node> children;
+        int min{0};
+        int max{0};
+        bool greedy{true};
+        int capture{-1};
+    };
+
+    /**
+     * @brief Recursive descent parser for the supported subset of the ECMAScript syntax
+    */
+    class regex_parser {
+    private:
+        std::string_view _regex;
+        size_t _position{0};
+        bool _ignore_case;
+        int _groups{0};
+
+        [[noreturn]] void fail(const char *message) const {
+            throw littlesmith::formatException<std::runtime_error>("Invalid regular expression at position %zu: %s",
+                                                                   _position, message);
+        }
+
+        [[nodiscard]] bool more() const { return _position < _regex.size(); }
+
+        [[nodiscard]] char peek() const { return _regex[_position]; }
+
+        regex_node single(const char_class &characters) const {
+            regex_node node;
+            node.kind = regex_node::character_class;
+            node.characters = characters;
+            if (_ignore_case) {
+                fold_case(node.characters);
+            }
+            return node;
+        }
+
+        /**
+         * @brief Parses the escape after a backslash into a class
+        */
+        char_class escape() {
+            if (!more()) {
+                fail("trailing backslash");
+            }
+            char c = _regex[_position++];
+            char_class result{};
+            switch (c) {
+                case 'd':
+                case 'D':
+                    set_range(result, '0', '9');
+                    break;
+                case 'w':
+                case 'W':
+                    set_range(result, '0', '9');
+                    set_range(result, 'a', 'z');
+                    set_range(result, 'A', 'Z');
+                    set(result, '_');
+                    break;
+                case 's':
+                case 'S':
+                    for (char space: {' ', '\t', '\n', '\r', '\f', '\v'}) {
+                        set(result, static_cast<uint8_t>(space));
+                    }
+                    break;
+                case 't':
+                    set(result, '\t');
+                    return result;
+                case 'n':
+                    set(result, '\n');
+                    return result;
+                case 'r':
+                    set(result, '\r');
+                    return result;
+                case 'f':
+                    set(result, '\f');
+                    return result;
+                case 'v':
+                    set(result, '\v');
+                    return result;
+                case 'b':
+                case 'B':
+                    fail("word boundaries are not supported");
+                default:
+                    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                        fail("unknown escape or back reference, back references are not supported");
+                    }
+                    set(result, static_cast<uint8_t>(c));
+                    return result;
+            }
+            return c >= 'A' && c <= 'Z' ? negate(result) : result;
+        }
+
+        char_class bracket() {
+            char_class result{};
+            bool negated = more() && peek() == '^';
+            if (negated) {
+                _position++;
+            }
+            bool first = true;
+            while (true) {
+                if (!more()) {
+                    fail("missing ]");
+                }
+                char c = _regex[_position++];
+                if (c == ']' && !first) {
+                    break;
+                }
+                first = false;
+                char_class item{};
+                int low;
+                if (c == '\\') {
+                    item = escape();
+                    // a range can only start at a single character
+                    low = -1;
+                    int count = 0;
+                    for (unsigned character = 0; character < 256; character++) {
+                        if (test(item, static_cast<uint8_t>(character))) {
+                            low = static_cast<int>(character);
+                            count++;
+                        }
+                    }
+                    if (count != 1) {
+                        low = -1;
+                    }
+                } else {
+                    set(item, static_cast<uint8_t>(c));
+                    low = static_cast<uint8_t>(c);
+                }
+                if (low >= 0 && _position + 1 < _regex.size() && peek() == '-' && _regex[_position + 1] != ']') {
+                    _position++;
+                    char h = _regex[_position++];
+                    int high;
+                    if (h == '\\') {
+                        auto upper = escape();
+                        high = -1;
+                        for (unsigned character = 0; character < 256; character++) {
+                            if (test(upper, static_cast<uint8_t>(character))) {
+                                high = high == -1 ? static_cast<int>(character) : -2;
+                            }
+                        }
+                        if (high < 0) {
+                            fail("invalid range");
+                        }
+                    } else {
+                        high = static_cast<uint8_t>(h);
+                    }
+                    if (high < low) {
+                        fail("invalid range");
+                    }
+                    set_range(item, static_cast<uint8_t>(low), static_cast<uint8_t>(high));
+                }
+                unite(result, item);
+            }
+            if (_ignore_case) {
+                fold_case(result);
+            }
+            return negated ? negate(result) : result;
+        }
+
+        regex_node atom() {
+            char c = _regex[_position++];
+            regex_node node;
+            switch (c) {
+                case '(': {
+                    node.kind = regex_node::group;
+                    if (_regex.substr(_position).starts_with("?:")) {
+                        _position += 2;
+                    } else if (more() && peek() == '?') {
+                        fail("look-arounds are not supported");
+                    } else {
+                        node.capture = ++_groups;
+                    }
+                    node.children.push_back(alternation());
+                    if (!more() || peek() != ')') {
+                        fail("missing )");
+                    }
+                    _position++;
+                    return node;
+                }
+                case '[':
+                    node.kind = regex_node::character_class;
+                    node.characters = bracket();
+                    return node;
+                case '.': {
+                    char_class any{};
+                    any = negate(any);
+                    any[0] &= ~((uint64_t(1) << '\n') | (uint64_t(1) << '\r'));
+                    node.kind = regex_node::character_class;
+                    node.characters = any;
+                    return node;
+                }
+                case '^':
+                    node.kind = regex_node::begin;
+                    return node;
+                case '$':
+                    node.kind = regex_node::end;
+                    return node;
+                case '\\':
+                    return single(escape());
+                case '*':
+                case '+':
+                case '?':
+                    _position--;
+                    fail("nothing to repeat");
+                default: {
+                    char_class literal{};
+                    set(literal, static_cast<uint8_t>(c));
+                    return single(literal);
+                }
+            }
+        }
+
+        /**
+         * @brief Parses {n}, {n,} or {n,m}, anything else is a literal {
+        */
+        bool bounds(int &min, int &max) {
+            size_t position = _position + 1;
+            auto number = [&](int &value) {
+                size_t start = position;
+                value = 0;
+                while (position < _regex.size() && _regex[position] >= '0' && _regex[position] <= '9') {
+                    value = std::min(value * 10 + (_regex[position] - '0'), MAX_REPEAT + 1);
+                    position++;
+                }
+                return position > start;
+            };
+            if (!number(min)) {
+                return false;
+            }
+            max = min;
+            if (position < _regex.size() && _regex[position] == ',') {
+                position++;
+                if (!number(max)) {
+                    max = -1;
+                }
+            }
+            if (position >= _regex.size() || _regex[position] != '}') {
+                return false;
+            }
+            _position = position + 1;
+            if (min > MAX_REPEAT || max > MAX_REPEAT) {
+                fail("repetition count too large");
+            }
+            if (max != -1 && max < min) {
+                fail("invalid repetition count");
+            }
+            return true;
+        }
+
+        regex_node repetition() {
+            auto node = atom();
+            while (more()) {
+                int min, max;
+                char c = peek();
+                if (c == '*') {
+                    min = 0, max = -1;
+                    _position++;
+                } else if (c == '+') {
+                    min = 1, max = -1;
+                    _position++;
+                } else if (c == '?') {
+                    min = 0, max = 1;
+                    _position++;
+                } else if (c != '{' || !bounds(min, max)) {
+                    break;
+                }
+                regex_node repeated;
+                repeated.kind = regex_node::repetition;
+                repeated.min = min;
+                repeated.max = max;
+                if (more() && peek() == '?') {
+                    repeated.greedy = false;
+                    _position++;
+                }
+                repeated.children.push_back(std::move(node));
+                node = std::move(repeated);
+            }
+            return node;
+        }
+
+        regex_node concatenation() {
+            regex_node node;
+            node.kind = regex_node::concatenation;
+            while (more() && peek() != '|' && peek() != ')') {
+                node.children.push_back(repetition());
+            }
+            return node;
+        }
+
+    public:
+        regex_parser(std::string_view regex, bool ignore_case) : _regex(regex), _ignore_case(ignore_case) {}
+
+        regex_node alternation() {
+            regex_node node;
+            node.kind = regex_node::alternation;
+            node.children.push_back(concatenation());
+            while (more() && peek() == '|') {
+                _position++;
+                node.children.push_back(concatenation());
+            }
+            return node;
+        }
+
+        regex_node parse() {
+            auto node = alternation();
+            if (more()) {
+                fail("unmatched )");
+            }
+            return node;
+        }
+
+        [[nodiscard]] int groups() const { return _groups; }
+    };
+}
+
+name_pattern::name_pattern(std::string_view expression) {
+    if (expression.size() < 2 || expression[0] != 's' || expression[1] == '\\' || expression[1] == '\n') {
+        throw std::runtime_error("The pattern must be a substitution like s/regex/replacement/flags!");
+    }
+    char delimiter = expression[1];
+    std::vector<std::string_view> parts;
+    size_t start = 2;
+    for (size_t i = 2; i < expression.size() && parts.size() < 2; i++) {
+        if (expression[i] == '\\') {
+            i++;
+        } else if (expression[i] == delimiter) {
+            parts.push_back(expression.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    if (parts.size() < 2) {
+        throw littlesmith::formatException<std::runtime_error>("Unterminated substitution, missing %c!", delimiter);
+    }
+    for (char flag: expression.substr(start)) {
+        if (flag == 'g') {
+            _global = true;
+        } else if (flag == 'i' || flag == 'I') {
+            _ignore_case = true;
+        } else {
+            throw littlesmith::formatException<std::runtime_error>("Unknown flag %c in the substitution!", flag);
+        }
+    }
+    compile(parts[0]);
+    parse_replacement(parts[1]);
+}
+
+name_pattern::~name_pattern() = default;
+
+void name_pattern::compile(std::string_view regex) {
+    regex_parser parser(regex, _ignore_case);
+    auto tree = parser.parse();
+    _groups = static_cast<size_t>(parser.groups());
+    auto emit = [this](opcode op, uint32_t x = 0, uint32_t y = 0) {
+        if (_program.size() >= MAX_PROGRAM_SIZE) {
+            throw std::runtime_error("The regular expression is too large!");
+        }
+        _program.push_back({op, x, y});
+        return static_cast<uint32_t>(_program.size() - 1);
+    };
+    auto here = [this] { return static_cast<uint32_t>(_program.size()); };
+    // the preferred branch of a split is x, a lazy quantifier prefers to leave the loop
+    auto split = [&](uint32_t stay, uint32_t leave, bool greedy) {
+        return greedy ? emit(opcode::split, stay, leave) : emit(opcode::split, leave, stay);
+    };
+    auto patch_leave = [this](uint32_t pc, uint32_t target, bool greedy) {
+        (greedy ? _program[pc].y : _program[pc].x) = target;
+    };
+    std::function<void(const regex_node &)> generate = [&](const regex_node &node) {
+        switch (node.kind) {
+            case regex_node::empty:
+                break;
+            case regex_node::character_class: {
+                _classes.push_back(node.characters);
+                emit(opcode::character_class, static_cast<uint32_t>(_classes.size() - 1));
+                break;
+            }
+            case regex_node::concatenation:
+                for (const auto &child: node.children) {
+                    generate(child);
+                }
+                break;
+            case regex_node::alternation: {
+                if (node.children.size() == 1) {
+                    generate(node.children[0]);
+                    break;
+                }
+                std::vector<uint32_t> jumps;
+                for (size_t i = 0; i + 1 < node.children.size(); i++) {
+                    auto fork = emit(opcode::split, here() + 1, 0);
+                    generate(node.children[i]);
+                    jumps.push_back(emit(opcode::jump));
+                    _program[fork].y = here();
+                }
+                generate(node.children.back());
+                for (auto jump: jumps) {
+                    _program[jump].x = here();
+                }
+                break;
+            }
+            case regex_node::group:
+                if (node.capture >= 0) {
+                    emit(opcode::save, static_cast<uint32_t>(2 * node.capture));
+                }
+                generate(node.children[0]);
+                if (node.capture >= 0) {
+                    emit(opcode::save, static_cast<uint32_t>(2 * node.capture + 1));
+                }
+                break;
+            case regex_node::repetition: {
+                const auto &child = node.children[0];
+                for (int i = 0; i < node.min; i++) {
+                    generate(child);
+                }
+                if (node.max == -1) {
+                    // L1: split L2, L3; L2: child; jump L1; L3:
+                    auto loop = split(here() + 1, 0, node.greedy);
+                    generate(child);
+                    emit(opcode::jump, loop);
+                    patch_leave(loop, here(), node.greedy);
+                } else {
+                    // every optional copy may leave to the end, like nested (child(child)?)?
+                    std::vector<uint32_t> forks;
+                    for (int i = node.min; i < node.max; i++) {
+                        forks.push_back(split(here() + 1, 0, node.greedy));
+                        generate(child);
+                    }
+                    for (auto fork: forks) {
+                        patch_leave(fork, here(), node.greedy);
+                    }
+                }
+                break;
+            }
+            case regex_node::begin:
+                emit(opcode::begin);
+                break;
+            case regex_node::end:
+                emit(opcode::end);
+                break;
+        }
+    };
+    emit(opcode::save, 0);
+    generate(tree);
+    emit(opcode::save, 1);
+    emit(opcode::match);
+}
+
+void name_pattern::parse_replacement(std::string_view replacement) {
+    std::string text;
+    auto flush = [&] {
+        if (!text.empty()) {
+            _replacement.push_back({text, -1});
+            text.clear();
+        }
+    };
+    for (size_t i = 0; i < replacement.size(); i++) {
+        char c = replacement[i];
+        if (c == '&') {
+            flush();
+            _replacement.push_back({"", 0});
+        } else if (c == '\\' && i + 1 < replacement.size()) {
+            char next = replacement[++i];
+            if (next >= '0' && next <= '9') {
+                auto group = static_cast<size_t>(next - '0');
+                if (group > _groups) {
+                    throw littlesmith::formatException<std::runtime_error>(
+                            "The replacement refers to group %zu, but the regular expression has only %zu!", group, _groups);
+                }
+                flush();
+                _replacement.push_back({"", static_cast<int>(group)});
+            } else if (next == 'n') {
+                text += '\n';
+            } else if (next == 't') {
+                text += '\t';
+            } else {
+                text += next;
+            }
+        } else {
+            text += c;
+        }
+    }
+    flush();
+}
+
+std::unique_ptr<name_pattern::matcher> name_pattern::acquire() const {
+    {
+        std::lock_guard lock(_mutex);
+        if (!_matchers.empty()) {
+            auto m = std::move(_matchers.back());
+            _matchers.pop_back();
+            return m;
+        }
+    }
+    return std::make_unique<matcher>(*this);
+}
+
+void name_pattern::release(std::unique_ptr<matcher> m) const {
+    std::lock_guard lock(_mutex);
+    _matchers.push_back(std::move(m));
+}
+
+bool name_pattern::substitute(std::string_view name, std::string &result) const {
+    auto m = acquire();
+    bool matched = m->substitute(name, result);
+    release(std::move(m));
+    return matched;
+}
+
+void name_pattern::substitute(const std::vector<std::string> &names, std::vector<std::string> &results) const {
+    auto m = acquire();
+    results.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        m->substitute(names[i], results[i]);
+    }
+    release(std::move(m));
+}
+
+name_pattern::matcher::matcher(const name_pattern &pattern) :
+    _pattern(pattern), _marks(pattern._program.size(), 0) {
+}
+
+uint32_t name_pattern::matcher::generation() {
+    if (++_generation == 0) {
+        std::fill(_marks.begin(), _marks.end(), 0);
+        _generation = 1;
+    }
+    return _generation;
+}
+
+void name_pattern::matcher::closure(std::vector<uint32_t> &set, bool begin, bool end) {
+    const auto &program = _pattern._program;
+    auto mark = generation();
+    _stack.assign(set.rbegin(), set.rend());
+    set.clear();
+    while (!_stack.empty()) {
+        auto pc = _stack.back();
+        _stack.pop_back();
+        if (_marks[pc] == mark) {
+            continue;
+        }
+        _marks[pc] = mark;
+        const auto &instruction = program[pc];
+        switch (instruction.op) {
+            case opcode::jump:
+                _stack.push_back(instruction.x);
+                break;
+            case opcode::split:
+                _stack.push_back(instruction.y);
+                _stack.push_back(instruction.x);
+                break;
+            case opcode::save:
+                _stack.push_back(pc + 1);
+                break;
+            case opcode::begin:
+                if (begin) {
+                    _stack.push_back(pc + 1);
+                }
+                break;
+            case opcode::end:
+                if (end) {
+                    _stack.push_back(pc + 1);
+                } else {
+                    // decided when the end of the name is reached
+                    set.push_back(pc);
+                }
+                break;
+            case opcode::character_class:
+            case opcode::match:
+                set.push_back(pc);
+                break;
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+int32_t name_pattern::matcher::state(std::vector<uint32_t> &set) {
+    auto it = _index.find(set);
+    if (it != _index.end()) {
+        return it->second;
+    }
+    dfa_state s;
+    s.pcs = set;
+    s.next.fill(UNKNOWN);
+    for (auto pc: set) {
+        s.match = s.match || _pattern._program[pc].op == opcode::match;
+    }
+    _states.push_back(std::move(s));
+    auto index = static_cast<int32_t>(_states.size() - 1);
+    _index.emplace(set, index);
+    return index;
+}
+
+int32_t name_pattern::matcher::step(int32_t from, uint8_t c) {
+    const auto &program = _pattern._program;
+    _set.clear();
+    for (auto pc: _states[from].pcs) {
+        if (program[pc].op == opcode::character_class && test(_pattern._classes[program[pc].x], c)) {
+            _set.push_back(pc + 1);
+        }
+    }
+    // the search is unanchored, a match can start at every position
+    _set.push_back(0);
+    closure(_set, false, false);
+    if (_states.size() >= MAX_DFA_STATES) {
+        // keep only the state we are in
+        auto current = _states[from].pcs;
+        _states.clear();
+        _index.clear();
+        _start = UNKNOWN;
+        from = state(current);
+    }
+    auto to = state(_set);
+    _states[from].next[c] = to;
+    return to;
+}
+
+bool name_pattern::matcher::end_match(int32_t from, bool begin) {
+    auto &s = _states[from];
+    if (s.end_match >= 0 && !begin) {
+        return s.end_match == 1;
+    }
+    _set.clear();
+    for (auto pc: s.pcs) {
+        if (_pattern._program[pc].op == opcode::end) {
+            _set.push_back(pc + 1);
+        }
+    }
+    bool match = false;
+    if (!_set.empty()) {
+        closure(_set, begin, true);
+        for (auto pc: _set) {
+            match = match || _pattern._program[pc].op == opcode::match;
+        }
+    }
+    if (!begin) {
+        _states[from].end_match = match ? 1 : 0;
+    }
+    return match;
+}
+
+bool name_pattern::matcher::contains(std::string_view text) {
+    if (_start == UNKNOWN) {
+        _set.assign(1, 0);
+        closure(_set, true, false);
+        _start = state(_set);
+    }
+    int32_t current = _start;
+    if (_states[current].match) {
+        return true;
+    }
+    for (auto character: text) {
+        auto c = static_cast<uint8_t>(character);
+        auto next = _states[current].next[c];
+        current = next == UNKNOWN ? step(current, c) : next;
+        if (_states[current].match) {
+            return true;
+        }
+    }
+    return end_match(current, text.empty());
+}
+
+void name_pattern::matcher::add(thread_list &list, uint32_t pc, int32_t *captures, size_t position, size_t length) {
+    const auto &program = _pattern._program;
+    auto count = 2 * (_pattern._groups + 1);
+    // like the recursive version: x before y, and a save is undone when its branch is done
+    _closure.clear();
+    _closure.push_back({pc, -1, 0});
+    while (!_closure.empty()) {
+        auto entry = _closure.back();
+        _closure.pop_back();
+        if (entry.slot >= 0) {
+            captures[entry.slot] = entry.value;
+            continue;
+        }
+        if (_marks[entry.pc] == _generation) {
+            continue;
+        }
+        _marks[entry.pc] = _generation;
+        const auto &instruction = program[entry.pc];
+        switch (instruction.op) {
+            case opcode::jump:
+                _closure.push_back({instruction.x, -1, 0});
+                break;
+            case opcode::split:
+                _closure.push_back({instruction.y, -1, 0});
+                _closure.push_back({instruction.x, -1, 0});
+                break;
+            case opcode::save: {
+                auto slot = static_cast<int32_t>(instruction.x);
+                _closure.push_back({0, slot, captures[slot]});
+                captures[slot] = static_cast<int32_t>(position);
+                _closure.push_back({entry.pc + 1, -1, 0});
+                break;
+            }
+            case opcode::begin:
+                if (position == 0) {
+                    _closure.push_back({entry.pc + 1, -1, 0});
+                }
+                break;
+            case opcode::end:
+                if (position == length) {
+                    _closure.push_back({entry.pc + 1, -1, 0});
+                }
+                break;
+            case opcode::character_class:
+            case opcode::match:
+                list.pcs.push_back(entry.pc);
+                list.captures.insert(list.captures.end(), captures, captures + count);
+                break;
+        }
+    }
+}
+
+bool name_pattern::matcher::search(std::string_view text, size_t start, bool continuation) {
+    const auto &program = _pattern._program;
+    auto count = 2 * (_pattern._groups + 1);
+    bool matched = false;
+    _current.pcs.clear();
+    _current.captures.clear();
+    generation();
+    for (size_t position = start; position <= text.size(); position++) {
+        if (!matched && (!continuation || position == start)) {
+            // the threads of earlier starts have priority over a match starting here
+            _captures.assign(count, -1);
+            add(_current, 0, _captures.data(), position, text.size());
+        }
+        if (_current.pcs.empty() && matched) {
+            break;
+        }
+        generation();
+        _next.pcs.clear();
+        _next.captures.clear();
+        for (size_t i = 0; i < _current.pcs.size(); i++) {
+            auto pc = _current.pcs[i];
+            auto *captures = _current.captures.data() + i * count;
+            const auto &instruction = program[pc];
+            if (instruction.op == opcode::match) {
+                if (continuation && captures[0] == captures[1]) {
+                    continue;
+                }
+                // the threads after this one have lower priority
+                _best.assign(captures, captures + count);
+                matched = true;
+                break;
+            }
+            if (position < text.size() &&
+                    test(_pattern._classes[instruction.x], static_cast<uint8_t>(text[position]))) {
+                add(_next, pc + 1, captures, position + 1, text.size());
+            }
+        }
+        std::swap(_current, _next);
+    }
+    return matched;
+}
+
+bool name_pattern::matcher::substitute(std::string_view name, std::string &result) {
+    if (!contains(name)) {
+        result.assign(name);
+        return false;
+    }
+    result.clear();
+    size_t position = 0;
+    bool matched = false;
+    bool empty = false;
+    while (position <= name.size()) {
+        // like std::regex_iterator: after an empty match, only a non-empty match at the same position counts
+        if (!search(name, position, empty)) {
+            if (!empty) {
+                break;
+            }
+            if (position < name.size()) {
+                result += name[position];
+            }
+            position++;
+            empty = false;
+            continue;
+        }
+        matched = true;
+        auto begin = static_cast<size_t>(_best[0]);
+        auto end = static_cast<size_t>(_best[1]);
+        result.append(name.substr(position, begin - position));
+        for (const auto &part: _pattern._replacement) {
+            if (part.group < 0) {
+                result += part.text;
+            } else if (_best[2 * part.group] >= 0) {
+                result.append(name.substr(static_cast<size_t>(_best[2 * part.group]),
+                                          static_cast<size_t>(_best[2 * part.group + 1] - _best[2 * part.group])));
+            }
+        }
+        position = end;
+        if (!_pattern._global) {
+            break;
+        }
+        empty = end == begin;
+    }
+    if (position < name.size()) {
+        result.append(name.substr(position));
+    }
+    return matched;
+}
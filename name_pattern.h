@@ -0,0 +1,191 @@
+/**
+* @file name_pattern.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the name_pattern class.
+ *
+ * Applies sed style substitutions to the scanned names without backtracking.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A substitution s/REGEX/REPLACEMENT/FLAGS compiled into an automaton
+ *
+ * The regular expression uses the ECMAScript syntax of std::regex without
+ * the parts that need backtracking: literals, ., [classes], \d \w \s and
+ * their negations, ^ and $ (begin and end of the name), groups (...) and
+ * (?:...), | and the greedy and lazy quantifiers * + ? {n} {n,} {n,m}.
+ * Back references and look-arounds are rejected. Like std::regex, the
+ * leftmost match wins and of the matches starting there, the one the
+ * quantifiers prefer. Only the groups inside a loop whose body can match
+ * the empty string, like ((a)?)*, may capture differently: an iteration
+ * that matches nothing ends the loop here, as ECMAScript demands, while
+ * libstdc++ lets it overwrite the groups.
+ *
+ * The replacement may contain & or \0 for the whole match and \1 to \9 for
+ * the groups, \& and \\ for the characters themselves and \n and \t. The
+ * flags are g (replace every match, not only the first) and i (ignore
+ * case, ASCII only). Any character can be the delimiter instead of /.
+ *
+ * The expression is compiled into a program for a Pike VM, which runs all
+ * alternatives in lock-step and never backtracks, so the time is linear in
+ * the length of the name. Before the VM, a lazily built DFA of the same
+ * program checks whether the name contains a match at all, with a single
+ * table lookup per character once the states are built.
+*/
+class name_pattern {
+public:
+    /**
+     * @brief The state of one thread applying a pattern
+     *
+     * Holds the DFA states built so far and the buffers of the VM, so
+     * every thread needs its own matcher. The pattern must outlive it.
+    */
+    class matcher {
+    private:
+        struct dfa_state {
+            std::vector<uint32_t> pcs;
+            std::array<int32_t, 256> next;
+            bool match{false};
+            int8_t end_match{-1};
+        };
+
+        struct thread_list {
+            std::vector<uint32_t> pcs;
+            std::vector<int32_t> captures;
+        };
+
+        struct closure_entry {
+            uint32_t pc;
+            int32_t slot;
+            int32_t value;
+        };
+
+        const name_pattern& _pattern;
+        std::vector<dfa_state> _states;
+        std::map<std::vector<uint32_t>, int32_t> _index;
+        int32_t _start{-1};
+        std::vector<uint32_t> _marks;
+        uint32_t _generation{0};
+        std::vector<uint32_t> _set;
+        std::vector<uint32_t> _stack;
+        std::vector<closure_entry> _closure;
+        thread_list _current;
+        thread_list _next;
+        std::vector<int32_t> _captures;
+        std::vector<int32_t> _best;
+
+        uint32_t generation();
+        void closure(std::vector<uint32_t>& set, bool begin, bool end);
+        int32_t state(std::vector<uint32_t>& set);
+        int32_t step(int32_t from, uint8_t c);
+        bool end_match(int32_t from, bool begin);
+        bool contains(std::string_view text);
+        void add(thread_list& list, uint32_t pc, int32_t* captures, size_t position, size_t length);
+        bool search(std::string_view text, size_t start, bool continuation = false);
+
+    public:
+        /**
+         * @brief Constructor for the matcher
+         *
+         * @param pattern The compiled pattern
+        */
+        explicit matcher(const name_pattern& pattern);
+
+        /**
+         * @brief Applies the substitution to a name
+         *
+         * @param name The name
+         * @param result Receives the name after the substitution, the name itself if nothing matched
+         * @returns true if the regular expression matched
+        */
+        bool substitute(std::string_view name, std::string& result);
+    };
+
+    /** @brief Limit for the size of the compiled program, counted repetitions are expanded */
+    static const size_t MAX_PROGRAM_SIZE = 65536;
+
+private:
+    enum class opcode : uint8_t {
+        character_class,
+        split,
+        jump,
+        save,
+        begin,
+        end,
+        match
+    };
+
+    struct instruction {
+        opcode op;
+        uint32_t x;
+        uint32_t y;
+    };
+
+    struct replacement_part {
+        std::string text;
+        int group;
+    };
+
+    std::vector<instruction> _program;
+    std::vector<std::array<uint64_t, 4>> _classes;
+    size_t _groups{0};
+    std::vector<replacement_part> _replacement;
+    bool _global{false};
+    bool _ignore_case{false};
+
+    mutable std::mutex _mutex;
+    mutable std::vector<std::unique_ptr<matcher>> _matchers;
+
+    std::unique_ptr<matcher> acquire() const;
+    void release(std::unique_ptr<matcher> m) const;
+
+    void compile(std::string_view regex);
+    void parse_replacement(std::string_view replacement);
+
+public:
+    /**
+     * @brief Constructor for the name_pattern, compiles the substitution
+     *
+     * @param expression The substitution, e.g. s/IMG_([0-9]+)/photo-\1/g
+     * @throws std::runtime_error if the expression is not valid
+    */
+    explicit name_pattern(std::string_view expression);
+    name_pattern(const name_pattern&) = delete;
+    name_pattern& operator=(const name_pattern&) = delete;
+    ~name_pattern();
+
+    /**
+     * @brief Applies the substitution to a name, can be called from several threads at once
+     *
+     * Uses one of a pool of matchers, so the DFA states are shared by the
+     * calls of a thread over time.
+     *
+     * @param name The name
+     * @param result Receives the name after the substitution, the name itself if nothing matched
+     * @returns true if the regular expression matched
+    */
+    bool substitute(std::string_view name, std::string& result) const;
+
+    /**
+     * @brief Applies the substitution to a batch of names, can be called from several threads at once
+     *
+     * @param names The names
+     * @param results Receives the names after the substitution, resized to the number of names
+    */
+    void substitute(const std::vector<std::string>& names, std::vector<std::string>& results) const;
+
+    /**
+     * @brief The number of capturing groups of the regular expression
+    */
+    [[nodiscard]] size_t groups() const { return _groups; }
+};
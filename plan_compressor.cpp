@@ -0,0 +1,298 @@
+/**
+* @file plan_compressor.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the plan_compressor class.
+ *
+ * Replaces the renames of all files of a directory by one rename of the directory.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <string>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "plan_compressor.h"
+#include "directory_cache.h"
+
+namespace {
+    bool inside(std::string_view path, std::string_view directory) {
+        return path.size() > directory.size() && path.starts_with(directory) && path[directory.size()] == '/';
+    }
+
+    /**
+     * @brief Whether a directory can be renamed to the new name, which may not exist yet
+     *
+     * A file is moved across filesystems by copying it, a directory is not.
+    */
+    bool same_filesystem(std::string_view path, std::string_view target) {
+        struct stat source{};
+        if (::stat(std::string(path).c_str(), &source) != 0) {
+            return false;
+        }
+        struct stat st{};
+        for (auto parent = split_path(target).first; !parent.empty(); parent = split_path(parent).first) {
+            if (::stat(std::string(parent).c_str(), &st) == 0) {
+                return st.st_dev == source.st_dev;
+            }
+            if (parent == "/") {
+                break;
+            }
+        }
+        return false;
+    }
+}
+
+bool plan_compressor::compress(std::vector<rename_operation> &operations) {
+    _directories.clear();
+    _members.clear();
+    _offsets.clear();
+    _collapsed = 0;
+    if (operations.size() >= std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    auto count = static_cast<uint32_t>(operations.size());
+    // the source directories by depth, so subdirectories are decided before their parents
+    std::vector<std::vector<std::string_view>> depths;
+    auto add = [&](std::string_view path) -> directory & {
+        auto [it, inserted] = _directories.try_emplace(path);
+        if (inserted) {
+            auto depth = static_cast<size_t>(std::count(path.begin(), path.end(), '/'));
+            if (depths.size() <= depth) {
+                depths.resize(depth + 1);
+            }
+            depths[depth].push_back(path);
+        }
+        return it->second;
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        auto [fromDirectory, fromName] = split_path(operations[i].from);
+        auto [toDirectory, toName] = split_path(operations[i].to);
+        auto &entry = add(fromDirectory);
+        if (fromName != toName || fromDirectory == toDirectory || fromDirectory.empty() || toDirectory.empty()) {
+            entry.consistent = false;
+        } else if (entry.target.empty() || entry.target == toDirectory) {
+            entry.target = toDirectory;
+            entry.files.push_back(i);
+        } else {
+            entry.consistent = false;
+        }
+    }
+    if (_directories.empty()) {
+        return false;
+    }
+
+    bool collapsed = false;
+    for (auto depth = depths.size(); depth-- > 0;) {
+        for (auto path: depths[depth]) {
+            auto &entry = _directories.find(path)->second;
+            if (!entry.consistent || entry.target.empty() || entry.target == path || inside(entry.target, path)) {
+                continue;
+            }
+            struct stat st{};
+            if (::lstat(std::string(entry.target).c_str(), &st) == 0 || errno != ENOENT) {
+                continue;
+            }
+            if (!same_filesystem(path, entry.target)) {
+                continue;
+            }
+            if (!entries_move(operations, path, entry)) {
+                continue;
+            }
+            entry.collapsed = true;
+            collapsed = true;
+            // the parent can move as a whole too if this directory keeps its name
+            auto [parent, name] = split_path(path);
+            auto [targetParent, targetName] = split_path(entry.target);
+            if (parent.empty() || parent == path) {
+                continue;
+            }
+            auto &up = add(parent);
+            if (name != targetName || parent == targetParent || (!up.target.empty() && up.target != targetParent)) {
+                up.consistent = false;
+                continue;
+            }
+            up.target = targetParent;
+        }
+    }
+    if (!collapsed) {
+        return false;
+    }
+
+    std::vector<bool> member;
+    while (conflicts(operations, member)) {
+    }
+    std::unordered_map<std::string_view, uint32_t> rootIndex;
+    for (auto &[path, entry]: _directories) {
+        if (!entry.collapsed) {
+            continue;
+        }
+        entry.root = path;
+        for (auto parent = split_path(path).first; !parent.empty() && parent != entry.root;
+             parent = split_path(parent).first) {
+            auto it = _directories.find(parent);
+            if (it == _directories.end() || !it->second.collapsed) {
+                break;
+            }
+            entry.root = parent;
+        }
+    }
+
+    // one rename per outermost collapsed directory, where its first file was
+    std::vector<rename_operation> compressed;
+    std::vector<uint32_t> position(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!member[i]) {
+            position[i] = static_cast<uint32_t>(compressed.size());
+            compressed.push_back(operations[i]);
+            continue;
+        }
+        auto root = _directories.find(split_path(operations[i].from).first)->second.root;
+        auto [it, inserted] = rootIndex.try_emplace(root, static_cast<uint32_t>(compressed.size()));
+        if (inserted) {
+            compressed.push_back({operations[i].line, root, _directories.find(root)->second.target});
+        }
+        position[i] = it->second;
+        _collapsed++;
+    }
+    if (rootIndex.empty()) {
+        return false;
+    }
+    _offsets.assign(compressed.size() + 1, 0);
+    for (auto p: position) {
+        _offsets[p + 1]++;
+    }
+    for (size_t i = 1; i < _offsets.size(); i++) {
+        _offsets[i] += _offsets[i - 1];
+    }
+    _members.resize(count);
+    std::vector<uint32_t> next(_offsets.begin(), _offsets.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        _members[next[position[i]]++] = i;
+    }
+    operations.swap(compressed);
+    return true;
+}
+
+bool plan_compressor::entries_move(const std::vector<rename_operation> &operations, std::string_view path,
+                                   const directory &entry) const {
+    std::unordered_set<std::string_view> names;
+    for (auto i: entry.files) {
+        names.insert(split_path(operations[i].from).second);
+    }
+    auto dir = ::opendir(std::string(path).c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    size_t files = 0;
+    bool moves = true;
+    std::string child;
+    std::string expected;
+    while (moves) {
+        auto e = ::readdir(dir);
+        if (e == nullptr) {
+            break;
+        }
+        const char *name = e->d_name;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+            continue;
+        }
+        bool isDirectory = e->d_type == DT_DIR;
+        if (e->d_type == DT_UNKNOWN) {
+            struct stat st{};
+            isDirectory = ::fstatat(::dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (!isDirectory) {
+            files++;
+            moves = names.contains(name);
+            continue;
+        }
+        // a subdirectory has to move to the same name below the new directory
+        child.assign(path).append("/").append(name);
+        expected.assign(entry.target).append("/").append(name);
+        auto it = _directories.find(child);
+        moves = it != _directories.end() && it->second.collapsed && it->second.target == expected;
+    }
+    ::closedir(dir);
+    return moves && files == entry.files.size();
+}
+
+bool plan_compressor::conflicts(const std::vector<rename_operation> &operations, std::vector<bool> &member) {
+    member.assign(operations.size(), false);
+    std::vector<std::string_view> invalid;
+    // the new names of all collapsed directories, a new name used twice keeps both
+    std::unordered_map<std::string_view, std::string_view> targets;
+    for (const auto &[path, entry]: _directories) {
+        if (!entry.collapsed) {
+            continue;
+        }
+        auto [it, inserted] = targets.try_emplace(entry.target, path);
+        if (!inserted) {
+            invalid.push_back(path);
+            invalid.push_back(it->second);
+        }
+        for (auto i: entry.files) {
+            member[i] = true;
+        }
+    }
+    // the directories the remaining renames and the collapsed directories go to
+    std::unordered_set<std::string_view> targetDirectories;
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (member[i]) {
+            continue;
+        }
+        auto it = targets.find(operations[i].to);
+        if (it != targets.end()) {
+            invalid.push_back(it->second);
+        }
+        targetDirectories.insert(split_path(operations[i].to).first);
+    }
+    for (const auto &[path, entry]: _directories) {
+        auto parent = split_path(path).first;
+        auto it = _directories.find(parent);
+        if (entry.collapsed && (it == _directories.end() || !it->second.collapsed)) {
+            targetDirectories.insert(split_path(entry.target).first);
+        }
+    }
+    // nothing may be created in or below the old or new name of a collapsed directory
+    for (auto directory: targetDirectories) {
+        for (auto path = directory; !path.empty(); path = split_path(path).first) {
+            auto target = targets.find(path);
+            if (target != targets.end()) {
+                invalid.push_back(target->second);
+            }
+            auto source = _directories.find(path);
+            if (source != _directories.end() && source->second.collapsed) {
+                invalid.push_back(path);
+            }
+            if (path == "/") {
+                break;
+            }
+        }
+    }
+    for (auto path: invalid) {
+        invalidate(path);
+    }
+    return !invalid.empty();
+}
+
+void plan_compressor::invalidate(std::string_view path) {
+    // the directories containing it were only collapsed because it was
+    while (!path.empty()) {
+        auto it = _directories.find(path);
+        if (it == _directories.end() || !it->second.collapsed) {
+            return;
+        }
+        it->second.collapsed = false;
+        auto parent = split_path(path).first;
+        if (parent == path) {
+            return;
+        }
+        path = parent;
+    }
+}
@@ -0,0 +1,90 @@
+/**
+* @file plan_compressor.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the plan_compressor class.
+ *
+ * Replaces the renames of all files of a directory by one rename of the directory.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "rename_executor.h"
+
+/**
+ * @brief Collapses the file renames of a moved directory into a rename of the directory
+ *
+ * When a directory component is renamed in the list, every file below it
+ * is a separate rename to the same new directory with its name unchanged.
+ * If that is true for every entry of the directory, including its
+ * subdirectories (which have to move the same way themselves), the
+ * directory is renamed as a whole instead.
+ *
+ * The entries are read from disk, so nothing is moved that the plan does
+ * not move: a directory containing anything not in the plan, like an
+ * empty subdirectory or a file left out by the scan, stays and its files
+ * are renamed one by one. A directory is also kept if its new name exists,
+ * lies inside it or on another filesystem, or another rename of the plan
+ * puts a file into or below its old or new name.
+*/
+class plan_compressor {
+private:
+    struct directory {
+        /** @brief The new name of the directory, derived from its entries */
+        std::string_view target;
+        /** @brief The renames of the files directly in the directory */
+        std::vector<uint32_t> files;
+        /** @brief Whether everything in the directory moves the same way */
+        bool consistent{true};
+        /** @brief Whether the directory is renamed as a whole */
+        bool collapsed{false};
+        /** @brief The outermost collapsed directory containing it, itself if there is none */
+        std::string_view root;
+    };
+
+    std::unordered_map<std::string_view, directory> _directories;
+    /** @brief The renames each operation of the compressed plan stands for, empty if nothing was compressed */
+    std::vector<uint32_t> _members;
+    std::vector<uint32_t> _offsets;
+    size_t _collapsed{0};
+
+    bool entries_move(const std::vector<rename_operation>& operations, std::string_view path,
+                      const directory& entry) const;
+    bool conflicts(const std::vector<rename_operation>& operations, std::vector<bool>& member);
+    void invalidate(std::string_view path);
+
+public:
+    /**
+     * @brief Compresses the plan
+     *
+     * @param operations The plan, the renames of collapsed directories are replaced by one rename at the position of the first one
+     * @returns Whether the plan was changed
+    */
+    bool compress(std::vector<rename_operation>& operations);
+
+    /**
+     * @brief Calls f with the index in the uncompressed plan of every rename the operation stands for
+     *
+     * @param operation The index of the operation in the compressed plan
+    */
+    template<typename F>
+    void expand(size_t operation, F&& f) const {
+        if (_offsets.empty()) {
+            f(operation);
+            return;
+        }
+        for (auto i = _offsets[operation]; i < _offsets[operation + 1]; i++) {
+            f(static_cast<size_t>(_members[i]));
+        }
+    }
+
+    /**
+     * @brief The number of file renames replaced by directory renames in the last plan
+    */
+    [[nodiscard]] size_t collapsed() const { return _collapsed; }
+};
@@ -0,0 +1,59 @@
+/**
+* @file probes.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the static tracing probes of multirenamer.
+ *
+ * USDT probes for perf, bpftrace and SystemTap.
+ */
+
+#pragma once
+
+/**
+ * The probes are statically defined tracepoints (provider "multirenamer")
+ * as defined by <sys/sdt.h>. An unattached probe is a single nop in the
+ * code plus a note in the ELF file, the arguments are only evaluated into
+ * registers that are there anyway. A tracer lists them with
+ * `perf list sdt_multirenamer:*` or `bpftrace -l 'usdt:./multirenamer:*'`.
+ *
+ * Probes and arguments:
+ *   dir__open(path, length)                          scan starts to read a directory
+ *   dir__close(path, length, entries)                scan finished reading it
+ *   manifest__line(line, length)                     a line is written to a manifest
+ *   mkdir__start(path, length)                       rename creates a directory
+ *   mkdir__done(path, length, errno)                 errno is 0 on success
+ *   rename__start(from, from_length, to, to_length)  rename renames a file
+ *   rename__done(from, from_length, to, to_length, errno)
+ *   error(line, message)                             a failed rename or a conflict of the plan is logged
+ *
+ * Paths and lines are views into the manifests and are not NUL-terminated,
+ * read them with their length, e.g. str(arg0, arg1) in bpftrace. line is
+ * the line of the operation in the manifests, message is a C string. With
+ * --backend=io_uring, start is hit when the operation is queued and done
+ * when its completion is reaped.
+ *
+ * Without <sys/sdt.h> (package systemtap-sdt-dev or systemtap-sdt-devel), or
+ * with MULTIRENAMER_NO_PROBES defined, the probes compile to nothing and
+ * their arguments are not evaluated.
+*/
+
+#if !defined(MULTIRENAMER_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MULTIRENAMER_HAS_PROBES 1
+#endif
+#endif
+
+#ifdef MULTIRENAMER_HAS_PROBES
+#define MULTIRENAMER_PROBE1(name, a) DTRACE_PROBE1(multirenamer, name, a)
+#define MULTIRENAMER_PROBE2(name, a, b) DTRACE_PROBE2(multirenamer, name, a, b)
+#define MULTIRENAMER_PROBE3(name, a, b, c) DTRACE_PROBE3(multirenamer, name, a, b, c)
+#define MULTIRENAMER_PROBE4(name, a, b, c, d) DTRACE_PROBE4(multirenamer, name, a, b, c, d)
+#define MULTIRENAMER_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(multirenamer, name, a, b, c, d, e)
+#else
+#define MULTIRENAMER_PROBE1(name, a) ((void) sizeof(a))
+#define MULTIRENAMER_PROBE2(name, a, b) ((void) sizeof(a), (void) sizeof(b))
+#define MULTIRENAMER_PROBE3(name, a, b, c) ((void) sizeof(a), (void) sizeof(b), (void) sizeof(c))
+#define MULTIRENAMER_PROBE4(name, a, b, c, d) (MULTIRENAMER_PROBE2(name, a, b), MULTIRENAMER_PROBE2(name, c, d))
+#define MULTIRENAMER_PROBE5(name, a, b, c, d, e) (MULTIRENAMER_PROBE2(name, a, b), MULTIRENAMER_PROBE3(name, c, d, e))
+#endif
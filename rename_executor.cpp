@@ -0,0 +1,355 @@
+/**
+* @file rename_executor.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the rename_executor class.
+ *
+ * Executes the renames of a rename plan, optionally in parallel.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <littlesmith/util/Parallel.h>
+#include "rename_executor.h"
+#include "probes.h"
+#include "run_stats.h"
+
+namespace {
+    size_t find_root(std::vector<size_t>& parents, size_t i) {
+        while (parents[i] != i) {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+        return i;
+    }
+}
+
+rename_executor::rename_executor(unsigned threads, rename_backend backend, unsigned queue_depth) :
+    _threads(threads == 0 ? 1 : threads), _backend(backend), _queue_depth(queue_depth == 0 ? 1 : queue_depth) {
+    // leave half of the descriptors for everything else
+    size_t capacity = 1024;
+    struct rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        capacity = std::min<size_t>(capacity, limit.rlim_cur / 2 / _threads);
+    }
+    _workers.reserve(_threads);
+    for (unsigned i = 0; i < _threads; i++) {
+        _workers.emplace_back(capacity);
+    }
+}
+
+void rename_executor::worker::count() {
+    run_stats::instance().renames.fetch_add(renames, std::memory_order_relaxed);
+    renames = 0;
+}
+
+std::vector<std::vector<size_t>> rename_executor::shard(const std::vector<rename_operation> &operations) const {
+    // union-find over the directories, every operation joins its source and target parent
+    std::unordered_map<std::string_view, size_t> ids;
+    ids.reserve(operations.size());
+    std::vector<size_t> parents;
+    std::vector<size_t> directory(operations.size());
+    auto id = [&](std::string_view path) {
+        auto [it, inserted] = ids.try_emplace(path, parents.size());
+        if (inserted) {
+            parents.push_back(parents.size());
+        }
+        return it->second;
+    };
+    for (size_t i = 0; i < operations.size(); i++) {
+        auto a = find_root(parents, id(split_path(operations[i].from).first));
+        auto b = find_root(parents, id(split_path(operations[i].to).first));
+        if (a != b) {
+            parents[b] = a;
+        }
+        directory[i] = a;
+    }
+    std::unordered_map<size_t, size_t> shard_of_root;
+    std::vector<std::vector<size_t>> shards;
+    for (size_t i = 0; i < operations.size(); i++) {
+        auto root = find_root(parents, directory[i]);
+        auto [it, inserted] = shard_of_root.try_emplace(root, shards.size());
+        if (inserted) {
+            shards.emplace_back();
+        }
+        shards[it->second].push_back(i);
+    }
+    std::stable_sort(shards.begin(), shards.end(), [](const auto &a, const auto &b) { return a.size() > b.size(); });
+    return shards;
+}
+
+bool rename_executor::apply(const rename_operation &operation, const directory_tree &directories,
+                            worker &state, rename_failure &failure) {
+    try {
+        auto [oldDirectory, oldName] = split_path(operation.from);
+        auto [newDirectory, newName] = split_path(operation.to);
+        if (auto error = directories.error(newDirectory)) {
+            throw std::filesystem::filesystem_error("cannot create directories", newDirectory, error);
+        }
+#ifdef __linux__
+        int error = 0;
+        int oldFd = state.directories.open(oldDirectory);
+        int newFd = oldFd == -1 ? -1 : state.directories.open(newDirectory);
+        if (oldFd == -1 || newFd == -1) {
+            error = errno;
+        } else {
+            state.from.assign(oldName);
+            state.to.assign(newName);
+            state.renames++;
+            MULTIRENAMER_PROBE4(rename__start, operation.from.data(), operation.from.size(),
+                                operation.to.data(), operation.to.size());
+            if (::renameat2(oldFd, state.from.c_str(), newFd, state.to.c_str(), RENAME_NOREPLACE) != 0) {
+                error = errno;
+                if (error == EINVAL) {
+                    // the filesystem does not support RENAME_NOREPLACE, check by hand
+                    struct stat st{};
+                    if (::fstatat(newFd, state.to.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                        error = EEXIST;
+                    } else if (::renameat(oldFd, state.from.c_str(), newFd, state.to.c_str()) == 0) {
+                        error = 0;
+                    } else {
+                        error = errno;
+                    }
+                }
+            }
+            MULTIRENAMER_PROBE5(rename__done, operation.from.data(), operation.from.size(),
+                                operation.to.data(), operation.to.size(), error);
+        }
+        if (error != 0) {
+            throw std::filesystem::filesystem_error("cannot rename", operation.from, operation.to,
+                                                    std::error_code(error, std::system_category()));
+        }
+#else
+        state.renames++;
+        MULTIRENAMER_PROBE4(rename__start, operation.from.data(), operation.from.size(),
+                            operation.to.data(), operation.to.size());
+        std::error_code error;
+        std::filesystem::rename(operation.from, operation.to, error);
+        MULTIRENAMER_PROBE5(rename__done, operation.from.data(), operation.from.size(),
+                            operation.to.data(), operation.to.size(), error.value());
+        if (error) {
+            throw std::filesystem::filesystem_error("cannot rename", operation.from, operation.to, error);
+        }
+#endif
+    } catch (std::filesystem::filesystem_error &ex) {
+        failure.message = ex.what();
+        failure.error = ex.code().value();
+        return false;
+    }
+    return true;
+}
+
+std::vector<rename_failure> rename_executor::execute(const std::vector<rename_operation> &operations,
+                                                     const completion_callback &callback) {
+    _completed = callback ? &callback : nullptr;
+    std::vector<rename_failure> failures;
+    rename_failure failure{};
+    directory_tree directories;
+    for (const auto &operation: operations) {
+        auto newDirectory = split_path(operation.to).first;
+        if (split_path(operation.from).first != newDirectory) {
+            directories.add(newDirectory);
+        }
+    }
+    if (_backend == rename_backend::io_uring) {
+        io_uring_queue ring(_queue_depth);
+        if (ring.available()) {
+            phase_timer mkdirTimer("mkdir");
+            directories.create(ring, _workers[0].directories);
+            auto created = directories.created();
+            _created.assign(created.begin(), created.end());
+            mkdirTimer.stop();
+            phase_timer renameTimer("rename");
+            return execute(operations, directories, ring);
+        }
+        _backend = rename_backend::sync;
+    }
+    phase_timer mkdirTimer("mkdir");
+    directories.create(_threads, [this](unsigned worker) -> directory_cache & {
+        return _workers[worker].directories;
+    });
+    auto created = directories.created();
+    _created.assign(created.begin(), created.end());
+    mkdirTimer.stop();
+    phase_timer renameTimer("rename");
+    if (_threads == 1) {
+        for (size_t i = 0; i < operations.size(); i++) {
+            if (!apply(operations[i], directories, _workers[0], failure)) {
+                failure.operation = i;
+                failures.push_back(failure);
+            } else {
+                completed(i);
+            }
+        }
+        _workers[0].count();
+        return failures;
+    }
+    auto shards = shard(operations);
+    std::mutex mutex;
+    littlesmith::parallel_for(shards.size(), _threads, [&](size_t s, unsigned worker) {
+        std::vector<rename_failure> local;
+        rename_failure error{};
+        for (auto i: shards[s]) {
+            if (!apply(operations[i], directories, _workers[worker], error)) {
+                error.operation = i;
+                local.push_back(error);
+            } else {
+                completed(i);
+            }
+        }
+        _workers[worker].count();
+        if (!local.empty()) {
+            std::lock_guard lock(mutex);
+            std::move(local.begin(), local.end(), std::back_inserter(failures));
+        }
+    });
+    std::sort(failures.begin(), failures.end(), [](const auto &a, const auto &b) { return a.operation < b.operation; });
+    return failures;
+}
+
+std::vector<rename_failure> rename_executor::execute(const std::vector<rename_operation> &operations,
+                                                     const directory_tree &directories, io_uring_queue &ring) {
+    std::vector<rename_failure> failures;
+    rename_failure failure{};
+    auto &cache = _workers[0].directories;
+    // the fallback for single operations must not evict handles of operations in flight
+    worker fallback(0);
+
+    // operations waiting for their source or target path, the head of a queue owns the path
+    std::unordered_map<std::string_view, std::deque<size_t>> owners;
+    std::deque<size_t> ready;
+    std::vector<std::string> names;
+    std::vector<io_completion> completions;
+    names.reserve(2 * ring.capacity());
+    size_t next = 0;
+    size_t unfinished = 0;
+    uint64_t issued = 0;
+    const size_t window = 4 * static_cast<size_t>(ring.capacity());
+
+    auto owns = [&](size_t i) {
+        return owners[operations[i].from].front() == i && owners[operations[i].to].front() == i;
+    };
+    auto admit = [&](size_t i) {
+        unfinished++;
+        owners[operations[i].from].push_back(i);
+        if (operations[i].to != operations[i].from) {
+            owners[operations[i].to].push_back(i);
+        }
+        if (owns(i)) {
+            ready.push_back(i);
+        }
+    };
+    auto release = [&](std::string_view path) {
+        auto it = owners.find(path);
+        it->second.pop_front();
+        if (it->second.empty()) {
+            owners.erase(it);
+        } else if (owns(it->second.front())) {
+            ready.push_back(it->second.front());
+        }
+    };
+    auto finish = [&](size_t i) {
+        unfinished--;
+        release(operations[i].from);
+        if (operations[i].to != operations[i].from) {
+            release(operations[i].to);
+        }
+    };
+    auto reap = [&](unsigned wait) {
+        completions.clear();
+        ring.submit(wait, completions);
+        names.clear();
+        for (const auto &completion: completions) {
+            auto i = static_cast<size_t>(completion.user_data);
+            if (completion.result == -EINVAL) {
+                // RENAME_NOREPLACE is not supported here, the synchronous path handles that
+                if (!apply(operations[i], directories, fallback, failure)) {
+                    failure.operation = i;
+                    failures.push_back(failure);
+                } else {
+                    completed(i);
+                }
+            } else {
+                MULTIRENAMER_PROBE5(rename__done, operations[i].from.data(), operations[i].from.size(),
+                                    operations[i].to.data(), operations[i].to.size(), -completion.result);
+                if (completion.result < 0) {
+                    failures.push_back({i, std::filesystem::filesystem_error(
+                            "cannot rename", operations[i].from, operations[i].to,
+                            std::error_code(-completion.result, std::system_category())).what(),
+                                        -completion.result});
+                } else {
+                    completed(i);
+                }
+            }
+            finish(i);
+        }
+    };
+    auto queue = [&](size_t i) {
+        const auto &operation = operations[i];
+        auto [oldDirectory, oldName] = split_path(operation.from);
+        auto [newDirectory, newName] = split_path(operation.to);
+        if (directories.error(newDirectory)) {
+            // reported with the usual message
+            if (!apply(operation, directories, fallback, failure)) {
+                failure.operation = i;
+                failures.push_back(failure);
+            } else {
+                completed(i);
+            }
+            finish(i);
+            return;
+        }
+        // handles of queued renames must stay open, so never let the cache evict
+        auto depth = std::count(operation.from.begin(), operation.from.end(), '/') +
+                     std::count(operation.to.begin(), operation.to.end(), '/') + 2;
+        if (cache.size() + depth >= cache.capacity()) {
+            while (ring.pending() > 0) {
+                reap(ring.pending());
+            }
+            cache.clear();
+        }
+        int oldFd = cache.open(oldDirectory);
+        int newFd = oldFd == -1 ? -1 : cache.open(newDirectory);
+        if (oldFd == -1 || newFd == -1) {
+            auto error = errno;
+            failures.push_back({i, std::filesystem::filesystem_error(
+                    "cannot rename", operation.from, operation.to,
+                    std::error_code(error, std::system_category())).what(), error});
+            finish(i);
+            return;
+        }
+        names.emplace_back(oldName);
+        auto &from = names.back();
+        names.emplace_back(newName);
+        ring.rename(oldFd, from.c_str(), newFd, names.back().c_str(), RENAME_NOREPLACE, i);
+        issued++;
+        MULTIRENAMER_PROBE4(rename__start, operation.from.data(), operation.from.size(),
+                            operation.to.data(), operation.to.size());
+    };
+
+    while (next < operations.size() || unfinished > 0) {
+        while (next < operations.size() && unfinished < window) {
+            admit(next++);
+        }
+        while (!ready.empty() && ring.pending() < ring.capacity()) {
+            auto i = ready.front();
+            ready.pop_front();
+            queue(i);
+        }
+        reap(ring.pending() > 0 ? 1 : 0);
+    }
+    run_stats::instance().renames.fetch_add(issued, std::memory_order_relaxed);
+    fallback.count();
+    std::sort(failures.begin(), failures.end(), [](const auto &a, const auto &b) { return a.operation < b.operation; });
+    return failures;
+}
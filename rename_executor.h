@@ -0,0 +1,153 @@
+/**
+* @file rename_executor.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the rename_executor class.
+ *
+ * Executes the renames of a rename plan, optionally in parallel.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "directory_cache.h"
+#include "directory_tree.h"
+#include "io_uring_queue.h"
+
+/**
+ * @brief How the renames are handed to the kernel
+*/
+enum class rename_backend {
+    /** @brief One system call per operation, in one or more threads */
+    sync,
+    /** @brief Batches of operations submitted through an io_uring */
+    io_uring
+};
+
+/**
+ * @brief A single rename of the plan
+*/
+struct rename_operation {
+    /** @brief The line in the manifests the operation comes from (1 based) */
+    size_t line;
+    /** @brief The current name */
+    std::string_view from;
+    /** @brief The new name */
+    std::string_view to;
+};
+
+/**
+ * @brief A rename that could not be executed
+*/
+struct rename_failure {
+    /** @brief Index of the operation in the plan */
+    size_t operation;
+    /** @brief The error message */
+    std::string message;
+    /** @brief The errno of the failure, 0 if there is none */
+    int error{0};
+};
+
+/**
+ * @brief Executes a rename plan
+ *
+ * The plan is split into shards: two operations end up in the same shard
+ * if they touch a common directory, as source parent or as target parent.
+ * A shard is executed by one worker in plan order, so no two workers ever
+ * modify the same directory and the order of dependent renames is kept.
+ * The shards are distributed over the workers, largest first.
+ *
+ * Before the first rename, all target directories are created in one
+ * stage by a directory_tree, each of them once.
+ *
+ * On Linux every worker keeps the parent directories open in a
+ * directory_cache and renames with renameat2 relative to them, so the
+ * kernel does not walk the full paths again for every file. The renames
+ * use RENAME_NOREPLACE: an existing target is reported as error instead of
+ * being overwritten.
+ *
+ * With the io_uring backend, the directories and renames are queued as
+ * mkdirat and renameat operations and submitted in batches from a single
+ * thread, up to the queue depth are in flight at a time. Operations on the
+ * same path are still executed in plan order: an operation is only
+ * submitted after all earlier operations with the same source or target
+ * completed. If the kernel has no usable io_uring, the synchronous backend
+ * is used instead.
+*/
+class rename_executor {
+public:
+    /**
+     * @brief Callback receiving the index of every operation that was executed successfully
+     *
+     * Called right after the rename, from the thread that executed it.
+    */
+    using completion_callback = std::function<void(size_t operation)>;
+
+private:
+    struct worker {
+        directory_cache directories;
+        std::string from;
+        std::string to;
+        /** @brief Renames issued and not yet added to the run statistics */
+        uint64_t renames{0};
+
+        explicit worker(size_t capacity) : directories(capacity) {}
+
+        void count();
+    };
+
+    unsigned _threads;
+    rename_backend _backend;
+    unsigned _queue_depth;
+    std::vector<worker> _workers;
+    const completion_callback* _completed{nullptr};
+    std::vector<std::string> _created;
+
+    [[nodiscard]] std::vector<std::vector<size_t>> shard(const std::vector<rename_operation>& operations) const;
+    static bool apply(const rename_operation& operation, const directory_tree& directories,
+                      worker& state, rename_failure& failure);
+    std::vector<rename_failure> execute(const std::vector<rename_operation>& operations,
+                                        const directory_tree& directories, io_uring_queue& ring);
+    void completed(size_t operation) const {
+        if (_completed != nullptr) {
+            (*_completed)(operation);
+        }
+    }
+
+public:
+    /**
+     * @brief Constructor for the rename_executor
+     *
+     * @param threads The number of worker threads (1 executes the plan in order in the calling thread)
+     * @param backend The backend to use
+     * @param queue_depth The maximum number of operations in flight with the io_uring backend
+    */
+    explicit rename_executor(unsigned threads, rename_backend backend = rename_backend::sync,
+                             unsigned queue_depth = 256);
+
+    /**
+     * @brief Executes all operations of the plan
+     *
+     * @param operations The plan
+     * @param callback Optional callback receiving every operation executed successfully
+     * @returns The failed operations, ordered by their index in the plan
+    */
+    std::vector<rename_failure> execute(const std::vector<rename_operation>& operations,
+                                        const completion_callback& callback = nullptr);
+
+    /**
+     * @brief The backend the last execute() used
+     *
+     * Differs from the requested backend if io_uring is not available.
+    */
+    [[nodiscard]] rename_backend backend() const { return _backend; }
+
+    /**
+     * @brief The directories the last execute() created because they did not exist, parents first
+    */
+    [[nodiscard]] const std::vector<std::string>& created() const { return _created; }
+};
@@ -0,0 +1,245 @@
+/**
+* @file rename_journal.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the rename_journal class.
+ *
+ * Records the progress of a rename, so an interrupted rename can be resumed.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <littlesmith/util/Exceptions.h>
+#include "rename_journal.h"
+
+namespace {
+    const char MAGIC[8] = {'M', 'R', 'J', 'R', 'N', 'L', '0', '1'};
+    const size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(uint64_t);
+    const size_t RECORD_SIZE = 2 * sizeof(uint64_t);
+    /** @brief Mixed into the check value, so a zero filled record of operation 0 is not valid */
+    const uint64_t CHECK_SALT = 0x6A09E667F3BCC908ULL;
+
+    uint64_t check(uint64_t operation, uint64_t fingerprint) {
+        return operation ^ fingerprint ^ CHECK_SALT;
+    }
+
+    void write_fully(int fd, const char *data, size_t size, const std::filesystem::path &path) {
+        while (size > 0) {
+            auto n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::filesystem::filesystem_error("Could not write journal", path,
+                                                        std::error_code(errno, std::system_category()));
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    void sync(int fd, const std::filesystem::path &path) {
+        if (::fdatasync(fd) != 0) {
+            throw std::filesystem::filesystem_error("Could not sync journal", path,
+                                                    std::error_code(errno, std::system_category()));
+        }
+    }
+}
+
+rename_journal::rename_journal(const std::filesystem::path &path, uint64_t fingerprint, uint64_t operations,
+                               std::vector<bool> *completed, size_t batch, std::chrono::milliseconds interval) :
+    _path(path), _fingerprint(fingerprint), _batch(batch == 0 ? 1 : batch), _interval(interval) {
+    if (completed != nullptr) {
+        _fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (_fd < 0) {
+            throw littlesmith::formatException<std::runtime_error>(
+                    "No interrupted rename to resume, the journal %s does not exist!", path.c_str());
+        }
+        std::vector<char> data;
+        char block[64 * 1024];
+        while (true) {
+            auto n = ::read(_fd, block, sizeof(block));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            data.insert(data.end(), block, block + n);
+        }
+        uint64_t header[2];
+        if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            ::close(_fd);
+            throw littlesmith::formatException<std::runtime_error>("The journal %s is damaged!", path.c_str());
+        }
+        std::memcpy(header, data.data() + sizeof(MAGIC), sizeof(header));
+        if (header[0] != fingerprint || header[1] != operations) {
+            ::close(_fd);
+            throw littlesmith::formatException<std::runtime_error>(
+                    "The journal %s belongs to another rename plan, the rename file or the scan changed since the rename was interrupted!",
+                    path.c_str());
+        }
+        completed->assign(operations, false);
+        size_t valid = HEADER_SIZE;
+        while (valid + RECORD_SIZE <= data.size()) {
+            uint64_t record[2];
+            std::memcpy(record, data.data() + valid, sizeof(record));
+            if (record[1] != check(record[0], fingerprint) || record[0] >= operations) {
+                break;
+            }
+            (*completed)[record[0]] = true;
+            valid += RECORD_SIZE;
+        }
+        // new records go after the last valid one, a torn tail is dropped
+        if (::ftruncate(_fd, static_cast<off_t>(valid)) != 0 || ::lseek(_fd, 0, SEEK_END) < 0) {
+            auto error = errno;
+            ::close(_fd);
+            throw std::filesystem::filesystem_error("Could not open journal", path,
+                                                    std::error_code(error, std::system_category()));
+        }
+    } else {
+        _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (_fd < 0) {
+            throw std::filesystem::filesystem_error("Could not create journal", path,
+                                                    std::error_code(errno, std::system_category()));
+        }
+        char header[HEADER_SIZE];
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        std::memcpy(header + sizeof(MAGIC), &fingerprint, sizeof(fingerprint));
+        std::memcpy(header + sizeof(MAGIC) + sizeof(fingerprint), &operations, sizeof(operations));
+        try {
+            write_fully(_fd, header, sizeof(header), path);
+            sync(_fd, path);
+        } catch (...) {
+            ::close(_fd);
+            throw;
+        }
+        // the journal itself has to survive a crash, not only its content
+        int directory = ::open(path.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory >= 0) {
+            ::fsync(directory);
+            ::close(directory);
+        }
+    }
+    _thread = std::thread(&rename_journal::run, this);
+}
+
+rename_journal::~rename_journal() {
+    try {
+        close();
+    } catch (...) {
+        // a destructor must not throw, call close() to see errors
+    }
+}
+
+uint64_t rename_journal::fingerprint(const std::vector<rename_operation> &operations) {
+    // FNV-1a over line, old and new name of every operation
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto add = [&hash](const void *data, size_t size) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+        }
+    };
+    for (const auto &operation: operations) {
+        uint64_t line = operation.line;
+        add(&line, sizeof(line));
+        add(operation.from.data(), operation.from.size());
+        add("", 1);
+        add(operation.to.data(), operation.to.size());
+        add("", 1);
+    }
+    return hash;
+}
+
+void rename_journal::complete(size_t operation) {
+    std::lock_guard lock(_mutex);
+    _pending.push_back(operation);
+    _queued++;
+    if (_pending.size() >= _batch) {
+        _cv.notify_one();
+    }
+}
+
+void rename_journal::run() {
+    std::unique_lock lock(_mutex);
+    std::vector<uint64_t> records;
+    while (true) {
+        _cv.wait_for(lock, _interval, [this] { return _stop || _flush || _pending.size() >= _batch; });
+        _flush = false;
+        if (_pending.empty()) {
+            if (_stop) {
+                break;
+            }
+            continue;
+        }
+        records.swap(_pending);
+        auto target = _queued;
+        lock.unlock();
+        try {
+            write_records(records);
+        } catch (...) {
+            lock.lock();
+            if (!_error) {
+                _error = std::current_exception();
+            }
+            lock.unlock();
+        }
+        records.clear();
+        lock.lock();
+        _committed = target;
+        _committed_cv.notify_all();
+    }
+}
+
+void rename_journal::write_records(const std::vector<uint64_t> &operations) {
+    std::vector<uint64_t> data;
+    data.reserve(2 * operations.size());
+    for (auto operation: operations) {
+        data.push_back(operation);
+        data.push_back(check(operation, _fingerprint));
+    }
+    write_fully(_fd, reinterpret_cast<const char *>(data.data()), data.size() * sizeof(uint64_t), _path);
+    sync(_fd, _path);
+}
+
+void rename_journal::commit() {
+    std::unique_lock lock(_mutex);
+    auto target = _queued;
+    if (_committed < target) {
+        _flush = true;
+        _cv.notify_one();
+        _committed_cv.wait(lock, [&] { return _committed >= target; });
+    }
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void rename_journal::close() {
+    if (!_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_one();
+    _thread.join();
+    ::close(_fd);
+    _fd = -1;
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+uint64_t rename_journal::committed() {
+    std::lock_guard lock(_mutex);
+    return _committed;
+}
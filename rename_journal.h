@@ -0,0 +1,122 @@
+/**
+* @file rename_journal.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the rename_journal class.
+ *
+ * Records the progress of a rename, so an interrupted rename can be resumed.
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rename_executor.h"
+
+/**
+ * @brief Append-only journal of the operations of a rename plan
+ *
+ * The header identifies the plan by a fingerprint of all its operations
+ * and their number. After that, every executed rename appends the index of
+ * its operation. Failed operations are not recorded, a resumed rename
+ * tries them again.
+ *
+ * The records are made durable by group commit: complete() only queues
+ * the index, a background thread writes the queued records and calls
+ * fdatasync once the batch is full or the interval has passed, whichever
+ * comes first. A crash loses at most the records of the last batch; the
+ * renames behind them are found again when the rename is resumed (their
+ * source is gone and their target exists).
+ *
+ * Every record carries a check value derived from the fingerprint, so a
+ * torn or zero filled tail after a crash is ignored.
+*/
+class rename_journal {
+public:
+    /** @brief Default number of records committed together */
+    static constexpr size_t DEFAULT_BATCH = 4096;
+    /** @brief Default time after which queued records are committed anyway */
+    static constexpr std::chrono::milliseconds DEFAULT_INTERVAL{50};
+
+private:
+    std::filesystem::path _path;
+    int _fd{-1};
+    uint64_t _fingerprint;
+    size_t _batch;
+    std::chrono::milliseconds _interval;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::condition_variable _committed_cv;
+    std::vector<uint64_t> _pending;
+    uint64_t _queued{0};
+    uint64_t _committed{0};
+    bool _flush{false};
+    bool _stop{false};
+    std::exception_ptr _error;
+
+    void run();
+    void write_records(const std::vector<uint64_t>& operations);
+
+public:
+    /**
+     * @brief Constructor for the rename_journal
+     *
+     * Without completed, a new journal is created and an existing one is
+     * replaced. With completed, the existing journal is opened to resume:
+     * it must belong to the same plan, the operations it records are
+     * flagged in completed and new records are appended.
+     *
+     * @param path The journal file
+     * @param fingerprint The fingerprint of the plan, see fingerprint()
+     * @param operations The number of operations of the plan
+     * @param completed Receives the completed operations when resuming, null to start a new journal
+     * @param batch The number of records that triggers a commit
+     * @param interval The longest time a record waits for its commit
+     * @throws std::runtime_error if the journal cannot be written, or when resuming, if it is missing or belongs to another plan
+    */
+    rename_journal(const std::filesystem::path& path, uint64_t fingerprint, uint64_t operations,
+                   std::vector<bool>* completed = nullptr, size_t batch = DEFAULT_BATCH,
+                   std::chrono::milliseconds interval = DEFAULT_INTERVAL);
+    rename_journal(const rename_journal&) = delete;
+    rename_journal& operator=(const rename_journal&) = delete;
+
+    /**
+     * @brief Destructor, commits the queued records
+    */
+    ~rename_journal();
+
+    /**
+     * @brief Identifies a plan by its lines and names
+    */
+    static uint64_t fingerprint(const std::vector<rename_operation>& operations);
+
+    /**
+     * @brief Queues the record of an executed operation, can be called from several threads at once
+     *
+     * @param operation The index of the operation in the plan
+    */
+    void complete(size_t operation);
+
+    /**
+     * @brief Commits all queued records and waits until they are on stable storage
+    */
+    void commit();
+
+    /**
+     * @brief Commits the queued records, stops the commit thread and closes the file
+    */
+    void close();
+
+    /**
+     * @brief The number of records this journal object made durable so far
+    */
+    [[nodiscard]] uint64_t committed();
+};
@@ -0,0 +1,161 @@
+/**
+* @file rename_planner.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the rename_planner class.
+ *
+ * Checks a rename plan as a whole and orders it before anything is renamed.
+ */
+
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#include <littlesmith/util/Exceptions.h>
+#include "rename_planner.h"
+
+namespace {
+    const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    /** @brief Appended to the source of an operation in a cycle, followed by its line */
+    const char TEMPORARY_SUFFIX[] = ".multirenamer~";
+
+    /**
+     * @brief Open addressing hash table from paths to operation indices
+     *
+     * Only the indices are stored, the paths are compared through the plan.
+     * The load factor stays at 3/4, the probing is linear.
+    */
+    template<typename Key>
+    class path_table {
+    private:
+        std::vector<uint32_t> _slots;
+        Key _key;
+
+        [[nodiscard]] size_t slot(std::string_view path) const {
+            // maps the hash onto the table without a division
+            auto hash = static_cast<uint64_t>(std::hash<std::string_view>()(path));
+            return static_cast<size_t>(((hash >> 32) * _slots.size()) >> 32);
+        }
+
+    public:
+        path_table(size_t entries, Key key) : _slots(entries + entries / 3 + 1, NONE), _key(key) {}
+
+        /**
+         * @brief Inserts the operation, unless its path is already in the table
+         *
+         * @returns The operation already in the table with the same path, or NONE
+        */
+        uint32_t insert(uint32_t operation) {
+            auto path = _key(operation);
+            for (auto i = slot(path);; i = i + 1 == _slots.size() ? 0 : i + 1) {
+                if (_slots[i] == NONE) {
+                    _slots[i] = operation;
+                    return NONE;
+                }
+                if (_key(_slots[i]) == path) {
+                    return _slots[i];
+                }
+            }
+        }
+
+        /**
+         * @returns The operation with the path, or NONE
+        */
+        [[nodiscard]] uint32_t find(std::string_view path) const {
+            for (auto i = slot(path);; i = i + 1 == _slots.size() ? 0 : i + 1) {
+                if (_slots[i] == NONE || _key(_slots[i]) == path) {
+                    return _slots[i];
+                }
+            }
+        }
+    };
+}
+
+std::vector<rename_conflict> rename_planner::plan(std::vector<rename_operation> &operations) {
+    _moved = 0;
+    _cycles = 0;
+    std::vector<rename_conflict> conflicts;
+    if (operations.size() >= NONE) {
+        throw littlesmith::formatException<std::runtime_error>(
+                "The rename plan has %zu operations, at most %u are supported!", operations.size(), NONE - 1);
+    }
+    auto count = static_cast<uint32_t>(operations.size());
+    path_table targets(count, [&operations](uint32_t i) { return operations[i].to; });
+    path_table sources(count, [&operations](uint32_t i) { return operations[i].from; });
+    for (uint32_t i = 0; i < count; i++) {
+        auto other = targets.insert(i);
+        if (other != NONE) {
+            conflicts.push_back({operations[other].line, operations[i].line, operations[i].to, false});
+        }
+        other = sources.insert(i);
+        if (other != NONE) {
+            conflicts.push_back({operations[other].line, operations[i].line, operations[i].from, true});
+        }
+    }
+    if (!conflicts.empty()) {
+        return conflicts;
+    }
+
+    // next[i] is the operation that has to move the target of i out of the way first
+    std::vector<uint32_t> next(count, NONE);
+    std::vector<bool> waitedFor(count, false);
+    for (uint32_t i = 0; i < count; i++) {
+        auto blocker = sources.find(operations[i].to);
+        if (blocker != NONE) {
+            next[i] = blocker;
+            waitedFor[blocker] = true;
+            _moved++;
+        }
+    }
+    if (_moved == 0) {
+        return conflicts;
+    }
+
+    // every source and target is unique, so the operations form simple chains and cycles
+    std::vector<rename_operation> planned;
+    planned.reserve(count);
+    std::vector<bool> placed(count, false);
+    std::vector<uint32_t> chain;
+    // a chain starts at an operation nobody waits for, its end runs first
+    for (uint32_t i = 0; i < count; i++) {
+        if (waitedFor[i]) {
+            continue;
+        }
+        chain.clear();
+        for (auto j = i; j != NONE; j = next[j]) {
+            chain.push_back(j);
+        }
+        for (auto j = chain.rbegin(); j != chain.rend(); ++j) {
+            planned.push_back(operations[*j]);
+            placed[*j] = true;
+        }
+    }
+    // whatever is left forms cycles: a->tmp, then the rest of the cycle backwards, then tmp->b
+    for (uint32_t i = 0; i < count && planned.size() < count + 2 * _cycles; i++) {
+        if (placed[i]) {
+            continue;
+        }
+        chain.clear();
+        auto j = i;
+        do {
+            chain.push_back(j);
+            placed[j] = true;
+            j = next[j];
+        } while (j != i);
+        _cycles++;
+        const auto &first = operations[i];
+        auto name = std::string(first.from) + TEMPORARY_SUFFIX + std::to_string(first.line);
+        auto temporary = name;
+        for (unsigned attempt = 1; sources.find(temporary) != NONE || targets.find(temporary) != NONE; attempt++) {
+            temporary = name + "." + std::to_string(attempt);
+        }
+        std::string_view path = _temporary.emplace_back(std::move(temporary));
+        planned.push_back({first.line, first.from, path});
+        for (auto k = chain.size() - 1; k > 0; k--) {
+            planned.push_back(operations[chain[k]]);
+        }
+        planned.push_back({first.line, path, first.to});
+    }
+    operations.swap(planned);
+    return conflicts;
+}
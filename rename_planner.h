@@ -0,0 +1,75 @@
+/**
+* @file rename_planner.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the rename_planner class.
+ *
+ * Checks a rename plan as a whole and orders it before anything is renamed.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rename_executor.h"
+
+/**
+ * @brief Two operations of a plan that cannot both be executed
+*/
+struct rename_conflict {
+    /** @brief The line of the first operation */
+    size_t first;
+    /** @brief The line of the second operation */
+    size_t second;
+    /** @brief The path both operations rename to, or both rename from */
+    std::string_view path;
+    /** @brief true if both operations have the same source, false if they have the same target */
+    bool same_source;
+};
+
+/**
+ * @brief Analyses a complete rename plan and orders it so every rename can succeed
+ *
+ * Two operations with the same target, or with the same source, are
+ * conflicts: the plan is rejected before anything is renamed. Otherwise
+ * the operations form chains (the target of one is the source of the
+ * next) and cycles like a->b, b->a. The last operation of a chain is
+ * moved before the others, so every target is free when its rename runs.
+ * A cycle is broken with a temporary name next to one of its files:
+ * a->tmp, b->a, tmp->b. Operations without dependencies keep their order.
+ *
+ * Sources and targets are indexed in flat open addressing hash tables of
+ * 32 bit operation indices, so the analysis takes O(n) time and about 15
+ * bytes per operation besides the plan. The plan is only copied if it
+ * has to be reordered.
+*/
+class rename_planner {
+private:
+    std::deque<std::string> _temporary;
+    size_t _moved{0};
+    size_t _cycles{0};
+
+public:
+    /**
+     * @brief Analyses the plan and orders it
+     *
+     * @param operations The plan, reordered and extended by the renames to temporary names if there are no conflicts
+     * @returns The conflicts, the plan is unchanged if there are any
+     * @throws std::runtime_error if the plan has more than 4 billion operations
+    */
+    std::vector<rename_conflict> plan(std::vector<rename_operation>& operations);
+
+    /**
+     * @brief The number of operations that had to wait for another one, in the last plan
+    */
+    [[nodiscard]] size_t moved() const { return _moved; }
+
+    /**
+     * @brief The number of cycles broken with a temporary name, in the last plan
+    */
+    [[nodiscard]] size_t cycles() const { return _cycles; }
+};
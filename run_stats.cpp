@@ -0,0 +1,95 @@
+/**
+* @file run_stats.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the run_stats class.
+ *
+ * Counters and phase timings for --stats.
+ */
+
+#include <iomanip>
+
+#include <sys/resource.h>
+
+#include "run_stats.h"
+
+namespace {
+    /**
+     * @brief The peak resident set size of the process in bytes
+    */
+    uint64_t peak_rss() {
+        struct rusage usage{};
+        if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+}
+
+run_stats &run_stats::instance() {
+    static run_stats stats;
+    return stats;
+}
+
+void run_stats::phase(const std::string &name, double seconds) {
+    std::lock_guard lock(_mutex);
+    for (auto &[phase, total]: _phases) {
+        if (phase == name) {
+            total += seconds;
+            return;
+        }
+    }
+    _phases.emplace_back(name, seconds);
+}
+
+void run_stats::print(std::ostream &out, bool json) const {
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - _start;
+    std::vector<std::pair<std::string, uint64_t>> counters{
+            {"entries", entries}, {"files", files}, {"directories", directories},
+            {"directories_cached", directories_cached}, {"directories_pruned", directories_pruned},
+            {"directories_skipped", directories_skipped},
+            {"files_filtered", files_filtered}, {"bytes_read", bytes_read}, {"bytes_written", bytes_written},
+            {"mkdirs", mkdirs}, {"mkdir_failures", mkdir_failures}, {"renames", renames},
+            {"rename_failures", rename_failures}, {"renames_reordered", renames_reordered},
+            {"rename_cycles", rename_cycles}, {"renames_collapsed", renames_collapsed},
+            {"cross_device_moves", cross_device_moves}, {"bytes_copied", bytes_copied},
+            {"peak_rss_bytes", peak_rss()}};
+    std::vector<std::pair<std::string, double>> phases;
+    {
+        std::lock_guard lock(_mutex);
+        phases = _phases;
+    }
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(6);
+    if (json) {
+        out << "{";
+        for (const auto &[name, value]: counters) {
+            out << "\"" << name << "\": " << value << ", ";
+        }
+        out << "\"phases\": {";
+        for (size_t i = 0; i < phases.size(); i++) {
+            out << (i > 0 ? ", " : "") << "\"" << phases[i].first << "\": " << phases[i].second;
+        }
+        out << "}, \"total_seconds\": " << total.count() << "}" << std::endl;
+    } else {
+        out << "Statistics:" << std::endl;
+        for (const auto &[name, value]: counters) {
+            out << "  " << std::left << std::setw(20) << name << std::right << std::setw(16) << value << std::endl;
+        }
+        for (const auto &[name, seconds]: phases) {
+            out << "  " << std::left << std::setw(20) << name << std::right << std::setw(16) << seconds << " s";
+            if (name == "rename" && seconds > 0) {
+                out << "  (" << std::setprecision(0) << static_cast<double>(renames) / seconds << " renames/s)" << std::setprecision(6);
+            } else if (name == "scan" && seconds > 0) {
+                out << "  (" << std::setprecision(0) << static_cast<double>(entries) / seconds << " entries/s)" << std::setprecision(6);
+            }
+            out << std::endl;
+        }
+        out << "  " << std::left << std::setw(20) << "total" << std::right << std::setw(16) << total.count() << " s" << std::endl;
+    }
+    out.flags(flags);
+}
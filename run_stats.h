@@ -0,0 +1,118 @@
+/**
+* @file run_stats.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the run_stats class.
+ *
+ * Counters and phase timings for --stats.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Counters and phase timings of one run
+ *
+ * The counters are atomics, updated in batches so they can always be on:
+ * the scan adds its counts once per directory, the rename phase counts
+ * renames per thread and adds them with a relaxed fetch_add once per shard,
+ * and mkdirs once per set of directories created. Counting costs far less
+ * than the system calls it counts. There is one instance per process, see
+ * instance().
+*/
+class run_stats {
+private:
+    mutable std::mutex _mutex;
+    std::vector<std::pair<std::string, double>> _phases;
+    std::chrono::steady_clock::time_point _start{std::chrono::steady_clock::now()};
+
+public:
+    /** @brief Directory entries seen, without . and .. */
+    std::atomic<uint64_t> entries{0};
+    /** @brief Regular files found */
+    std::atomic<uint64_t> files{0};
+    /** @brief Directories read */
+    std::atomic<uint64_t> directories{0};
+    /** @brief Directories taken from the scan index instead of reading them */
+    std::atomic<uint64_t> directories_cached{0};
+    /** @brief Directories not read because of --exclude or --max-depth */
+    std::atomic<uint64_t> directories_pruned{0};
+    /** @brief Directories reached again through a symlink and not read a second time */
+    std::atomic<uint64_t> directories_skipped{0};
+    /** @brief Regular files left out by --include, --exclude or --newer-than */
+    std::atomic<uint64_t> files_filtered{0};
+    /** @brief Bytes read from manifests and hashed files */
+    std::atomic<uint64_t> bytes_read{0};
+    /** @brief Bytes written to manifests */
+    std::atomic<uint64_t> bytes_written{0};
+    /** @brief Directories created by mkdir */
+    std::atomic<uint64_t> mkdirs{0};
+    /** @brief mkdir calls that failed */
+    std::atomic<uint64_t> mkdir_failures{0};
+    /** @brief Renames issued */
+    std::atomic<uint64_t> renames{0};
+    /** @brief Renames that failed */
+    std::atomic<uint64_t> rename_failures{0};
+    /** @brief Renames moved behind the rename freeing their target */
+    std::atomic<uint64_t> renames_reordered{0};
+    /** @brief Rename cycles broken with a temporary name */
+    std::atomic<uint64_t> rename_cycles{0};
+    /** @brief File renames replaced by the rename of their directory */
+    std::atomic<uint64_t> renames_collapsed{0};
+    /** @brief Files moved to another filesystem by copying them */
+    std::atomic<uint64_t> cross_device_moves{0};
+    /** @brief Bytes copied to move files to another filesystem */
+    std::atomic<uint64_t> bytes_copied{0};
+
+    /**
+     * @brief The instance of the process
+    */
+    static run_stats& instance();
+
+    /**
+     * @brief Adds the wall time of a phase, phases with the same name add up
+    */
+    void phase(const std::string& name, double seconds);
+
+    /**
+     * @brief Writes the statistics
+     *
+     * @param out The stream
+     * @param json If true, a single JSON object, otherwise a table
+    */
+    void print(std::ostream& out, bool json) const;
+};
+
+/**
+ * @brief Measures the wall time of a phase with the monotonic clock until it is destroyed or stopped
+*/
+class phase_timer {
+private:
+    std::string _name;
+    std::chrono::steady_clock::time_point _start;
+    bool _running{true};
+
+public:
+    explicit phase_timer(std::string name) : _name(std::move(name)), _start(std::chrono::steady_clock::now()) {}
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+    ~phase_timer() { stop(); }
+
+    /**
+     * @brief Records the time since construction
+    */
+    void stop() {
+        if (_running) {
+            _running = false;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+            run_stats::instance().phase(_name, elapsed.count());
+        }
+    }
+};
@@ -0,0 +1,379 @@
+/**
+* @file scan_filter.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the glob_set and scan_filter classes.
+ *
+ * Decides which files the scan lists and which directories it reads.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#include <littlesmith/text/String.h>
+#include <littlesmith/util/Exceptions.h>
+#include "scan_filter.h"
+
+namespace {
+    /**
+     * @brief The state sets of the automaton simulation, one per thread
+    */
+    struct simulation {
+        std::vector<uint32_t> marks;
+        uint32_t generation{0};
+        std::vector<uint32_t> current;
+        std::vector<uint32_t> next;
+
+        uint32_t next_generation(size_t size) {
+            if (marks.size() < size) {
+                marks.resize(size, 0);
+            }
+            if (++generation == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                generation = 1;
+            }
+            return generation;
+        }
+    };
+
+    thread_local simulation state;
+
+    bool has_meta(std::string_view text) {
+        return text.find_first_of("*?[\\") != std::string_view::npos;
+    }
+
+    int64_t modification_time(const struct stat &st) {
+#ifdef __linux__
+        return st.st_mtim.tv_sec * 1'000'000'000LL + st.st_mtim.tv_nsec;
+#else
+        return st.st_mtime * 1'000'000'000LL;
+#endif
+    }
+}
+
+void glob_set::insert(std::unordered_map<std::string, bool> &map, std::string key, bool directoryOnly) {
+    auto [it, inserted] = map.emplace(std::move(key), directoryOnly);
+    if (!inserted) {
+        // a pattern for all entries wins over the same pattern for directories
+        it->second = it->second && directoryOnly;
+    }
+}
+
+void glob_set::add(std::string_view glob) {
+    std::string pattern(glob);
+    bool directoryOnly = false;
+    while (pattern.size() > 1 && pattern.ends_with('/')) {
+        pattern.pop_back();
+        directoryOnly = true;
+    }
+    bool anchored = pattern.starts_with('/');
+    if (anchored) {
+        pattern.erase(0, 1);
+    }
+    if (pattern.empty()) {
+        throw littlesmith::formatException<std::runtime_error>("Empty pattern \"%s\"", std::string(glob).c_str());
+    }
+    anchored = anchored || pattern.find('/') != std::string::npos;
+    if (!has_meta(pattern)) {
+        insert(anchored ? _paths : _names, pattern, directoryOnly);
+    } else if (!anchored && pattern.starts_with("*.") && !has_meta(pattern.substr(1))) {
+        insert(_extensions, pattern.substr(1), directoryOnly);
+    } else {
+        compile(anchored ? _path_automaton : _name_automaton, pattern, directoryOnly);
+    }
+    _size++;
+}
+
+void glob_set::compile(automaton &target, std::string_view glob, bool directoryOnly) {
+    auto &tokens = target.tokens;
+    target.starts.push_back(static_cast<uint32_t>(tokens.size()));
+    for (size_t i = 0; i < glob.size();) {
+        char c = glob[i];
+        if (c == '\\') {
+            if (i + 1 == glob.size()) {
+                throw littlesmith::formatException<std::runtime_error>("Pattern %s ends with \\", std::string(glob).c_str());
+            }
+            tokens.push_back({token_type::character, static_cast<uint8_t>(glob[i + 1]), false});
+            i += 2;
+        } else if (c == '?') {
+            tokens.push_back({token_type::any, 0, false});
+            i++;
+        } else if (c == '[') {
+            std::array<uint64_t, 4> characters{};
+            size_t j = i + 1;
+            bool negated = j < glob.size() && (glob[j] == '!' || glob[j] == '^');
+            if (negated) {
+                j++;
+            }
+            bool first = true;
+            while (j < glob.size() && (first || glob[j] != ']')) {
+                first = false;
+                auto from = static_cast<uint8_t>(glob[j]);
+                if (glob[j] == '\\' && j + 1 < glob.size()) {
+                    from = static_cast<uint8_t>(glob[++j]);
+                }
+                auto to = from;
+                if (j + 2 < glob.size() && glob[j + 1] == '-' && glob[j + 2] != ']') {
+                    to = static_cast<uint8_t>(glob[j + 2]);
+                    if (glob[j + 2] == '\\' && j + 3 < glob.size()) {
+                        to = static_cast<uint8_t>(glob[j + 3]);
+                        j++;
+                    }
+                    j += 2;
+                }
+                for (unsigned character = from; character <= to; character++) {
+                    characters[character >> 6] |= uint64_t(1) << (character & 63);
+                }
+                j++;
+            }
+            if (j >= glob.size()) {
+                throw littlesmith::formatException<std::runtime_error>("Pattern %s has an unterminated [", std::string(glob).c_str());
+            }
+            if (negated) {
+                for (auto &bits: characters) {
+                    bits = ~bits;
+                }
+            }
+            // like *, a class never matches the separator
+            characters['/' >> 6] &= ~(uint64_t(1) << ('/' & 63));
+            tokens.push_back({token_type::character_class, static_cast<uint32_t>(_classes.size()), false});
+            _classes.push_back(characters);
+            i = j + 1;
+        } else if (c == '*') {
+            size_t j = i;
+            while (j < glob.size() && glob[j] == '*') {
+                j++;
+            }
+            bool component = j - i == 2 && (i == 0 || glob[i - 1] == '/') && (j == glob.size() || glob[j] == '/');
+            if (component && j < glob.size()) {
+                // **/ matches nothing or any number of directories, so the rest starts at a component
+                tokens.push_back({token_type::globstar, 2, false});
+                tokens.push_back({token_type::directories, 0, false});
+                j++;
+            } else if (component) {
+                tokens.push_back({token_type::globstar, 1, false});
+            } else {
+                tokens.push_back({token_type::star, 0, false});
+            }
+            i = j;
+        } else {
+            tokens.push_back({token_type::character, static_cast<uint8_t>(c), false});
+            i++;
+        }
+    }
+    tokens.push_back({token_type::accept, 0, directoryOnly});
+}
+
+bool glob_set::run(const automaton &source, std::string_view text, bool directory) const {
+    if (source.starts.empty()) {
+        return false;
+    }
+    const auto &tokens = source.tokens;
+    auto &s = state;
+    uint32_t generation = 0;
+    // adds a token and every token reachable from it without consuming a character
+    auto add = [&](std::vector<uint32_t> &list, uint32_t pc, auto &&self) -> void {
+        if (s.marks[pc] == generation) {
+            return;
+        }
+        s.marks[pc] = generation;
+        list.push_back(pc);
+        if (tokens[pc].type == token_type::star) {
+            self(list, pc + 1, self);
+        } else if (tokens[pc].type == token_type::globstar) {
+            if (tokens[pc].value == 2) {
+                self(list, pc + 1, self);
+            }
+            self(list, pc + tokens[pc].value, self);
+        }
+    };
+    generation = s.next_generation(tokens.size());
+    s.current.clear();
+    for (auto pc: source.starts) {
+        add(s.current, pc, add);
+    }
+    for (char c: text) {
+        generation = s.next_generation(tokens.size());
+        s.next.clear();
+        auto character = static_cast<uint8_t>(c);
+        for (auto pc: s.current) {
+            const auto &t = tokens[pc];
+            switch (t.type) {
+                case token_type::character:
+                    if (character == t.value) {
+                        add(s.next, pc + 1, add);
+                    }
+                    break;
+                case token_type::any:
+                    if (c != '/') {
+                        add(s.next, pc + 1, add);
+                    }
+                    break;
+                case token_type::character_class:
+                    if ((_classes[t.value][character >> 6] >> (character & 63)) & 1) {
+                        add(s.next, pc + 1, add);
+                    }
+                    break;
+                case token_type::star:
+                    if (c != '/') {
+                        add(s.next, pc, add);
+                    }
+                    break;
+                case token_type::globstar:
+                    // the **/ form only enters its directories, they consume the characters
+                    if (t.value == 1) {
+                        add(s.next, pc, add);
+                    }
+                    break;
+                case token_type::directories:
+                    add(s.next, pc, add);
+                    if (c == '/') {
+                        add(s.next, pc + 1, add);
+                    }
+                    break;
+                case token_type::accept:
+                    break;
+            }
+        }
+        std::swap(s.current, s.next);
+        if (s.current.empty()) {
+            return false;
+        }
+    }
+    for (auto pc: s.current) {
+        if (tokens[pc].type == token_type::accept && (!tokens[pc].directory_only || directory)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool glob_set::matches(std::string_view path, std::string_view name, bool directory) const {
+    auto lookup = [directory](const std::unordered_map<std::string, bool> &map, std::string_view key) {
+        if (map.empty()) {
+            return false;
+        }
+        auto it = map.find(std::string(key));
+        return it != map.end() && (!it->second || directory);
+    };
+    if (lookup(_names, name) || lookup(_paths, path)) {
+        return true;
+    }
+    if (!_extensions.empty()) {
+        for (auto dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.', dot + 1)) {
+            if (lookup(_extensions, name.substr(dot))) {
+                return true;
+            }
+        }
+    }
+    return run(_name_automaton, name, directory) || run(_path_automaton, path, directory);
+}
+
+bool glob_set::matches_below(std::string_view path) const {
+    // a pattern matching path/ with a tail that can be empty matches path/ followed by any name
+    std::string directory(path);
+    directory += '/';
+    return run(_path_automaton, directory, false);
+}
+
+scan_filter::scan_filter(const std::vector<std::string> &include, const std::vector<std::string> &exclude,
+                         unsigned maxDepth, const std::string &newerThan) :
+    _max_depth(maxDepth), _newer_than_ns(0), _newer_than(!newerThan.empty()) {
+    for (const auto &glob: include) {
+        _include.add(glob);
+    }
+    for (const auto &glob: exclude) {
+        _exclude.add(glob);
+    }
+    if (_newer_than) {
+        _newer_than_ns = parse_time(newerThan);
+    }
+}
+
+int64_t scan_filter::parse_time(const std::string &text) {
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    size_t digits = 0;
+    while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+        digits++;
+    }
+    if (digits > 0 && digits + 1 == text.size()) {
+        int64_t unit = 0;
+        switch (text.back()) {
+            case 's': unit = 1; break;
+            case 'm': unit = 60; break;
+            case 'h': unit = 3600; break;
+            case 'd': unit = 86400; break;
+            case 'w': unit = 7 * 86400; break;
+            default: break;
+        }
+        if (unit != 0) {
+            return now - std::stoll(text.substr(0, digits)) * unit * 1'000'000'000LL;
+        }
+    }
+    std::tm tm{};
+    int consumed = -1;
+    if (std::sscanf(text.c_str(), "%4d-%2d-%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &consumed) == 3 &&
+            consumed > 0) {
+        auto rest = text.c_str() + consumed;
+        bool valid = *rest == 0;
+        if (*rest == 'T' || *rest == ' ') {
+            consumed = -1;
+            valid = std::sscanf(rest + 1, "%2d:%2d%n:%2d%n", &tm.tm_hour, &tm.tm_min, &consumed, &tm.tm_sec,
+                                &consumed) >= 2 && rest[1 + consumed] == 0;
+        }
+        if (valid) {
+            tm.tm_year -= 1900;
+            tm.tm_mon -= 1;
+            tm.tm_isdst = -1;
+            auto seconds = std::mktime(&tm);
+            if (seconds != -1) {
+                return static_cast<int64_t>(seconds) * 1'000'000'000LL;
+            }
+        }
+    }
+    struct stat st{};
+    if (::stat(text.c_str(), &st) == 0) {
+        return modification_time(st);
+    }
+    throw littlesmith::formatException<std::runtime_error>(
+            "Invalid time %s, use an age like 7d, a date like 2024-05-01 or the path of a file", text.c_str());
+}
+
+std::vector<std::string> scan_filter::split_list(const std::string &list) {
+    std::vector<std::string> result;
+    for (auto &part: littlesmith::split(list, ",")) {
+        if (!part.empty()) {
+            result.emplace_back(std::move(part));
+        }
+    }
+    return result;
+}
+
+bool scan_filter::descend(std::string_view path, std::string_view name, unsigned depth) const {
+    if (_max_depth != 0 && depth >= _max_depth) {
+        return false;
+    }
+    return _exclude.size() == 0 || !(_exclude.matches(path, name, true) || _exclude.matches_below(path));
+}
+
+bool scan_filter::select(std::string_view path, std::string_view name) const {
+    if (_exclude.size() != 0 && _exclude.matches(path, name, false)) {
+        return false;
+    }
+    return _include.size() == 0 || _include.matches(path, name, false);
+}
+
+bool scan_filter::newer(const std::string &file) const {
+    if (!_newer_than) {
+        return true;
+    }
+    struct stat st{};
+    return ::stat(file.c_str(), &st) == 0 && modification_time(st) > _newer_than_ns;
+}
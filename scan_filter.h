@@ -0,0 +1,174 @@
+/**
+* @file scan_filter.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definitions of the glob_set and scan_filter classes.
+ *
+ * Decides which files the scan lists and which directories it reads.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A set of glob patterns matched together
+ *
+ * The patterns use the shell syntax: * and ? match any characters but /,
+ * [abc], [a-z] and [!abc] match one character of a class, \ escapes the
+ * next character and ** as a whole path component also matches /. A
+ * pattern without / is matched against the name of an entry, a pattern
+ * with / against its path relative to the scanned directory. A pattern
+ * ending with / only matches directories.
+ *
+ * Plain names (.git, node_modules) and extensions (*.tmp) are looked up
+ * in hash tables. All other patterns are compiled into one automaton per
+ * kind (name or path), which is run for all of them at once, so the time
+ * per entry does not grow with the number of patterns.
+*/
+class glob_set {
+private:
+    enum class token_type : uint8_t {
+        character,
+        any,
+        character_class,
+        star,
+        globstar,
+        /** @brief The directories of a globstar followed by a slash: consumes any character, continues after a slash */
+        directories,
+        accept
+    };
+
+    struct token {
+        token_type type;
+        /** @brief The character, the index of the class, or the tokens skipped by a globstar matching nothing */
+        uint32_t value;
+        /** @brief For accept, whether the pattern only matches directories */
+        bool directory_only;
+    };
+
+    struct automaton {
+        std::vector<token> tokens;
+        std::vector<uint32_t> starts;
+    };
+
+    /** @brief Plain names and paths, mapped to true if they only match directories */
+    std::unordered_map<std::string, bool> _names;
+    std::unordered_map<std::string, bool> _paths;
+    /** @brief Extensions including the dot, mapped to true if they only match directories */
+    std::unordered_map<std::string, bool> _extensions;
+    automaton _name_automaton;
+    automaton _path_automaton;
+    std::vector<std::array<uint64_t, 4>> _classes;
+    size_t _size{0};
+
+    static void insert(std::unordered_map<std::string, bool>& map, std::string key, bool directoryOnly);
+    void compile(automaton& target, std::string_view glob, bool directoryOnly);
+    bool run(const automaton& source, std::string_view text, bool directory) const;
+
+public:
+    /**
+     * @brief Adds a pattern
+     *
+     * @param glob The pattern
+     * @throws std::runtime_error if the pattern is not valid
+    */
+    void add(std::string_view glob);
+
+    /**
+     * @brief Checks whether any pattern matches an entry
+     *
+     * @param path The path of the entry relative to the scanned directory
+     * @param name The name of the entry, the last component of path
+     * @param directory true if the entry is a directory
+    */
+    [[nodiscard]] bool matches(std::string_view path, std::string_view name, bool directory) const;
+
+    /**
+     * @brief Checks whether a pattern matches everything below a directory, like src/ followed by ** or *
+     *
+     * @param path The path of the directory relative to the scanned directory
+    */
+    [[nodiscard]] bool matches_below(std::string_view path) const;
+
+    /**
+     * @brief The number of patterns
+    */
+    [[nodiscard]] size_t size() const { return _size; }
+};
+
+/**
+ * @brief The filters of a scan: include and exclude patterns, depth and age
+ *
+ * Excluded directories and directories below the maximum depth are never
+ * opened. Include patterns and the age only select files, every directory
+ * that is not excluded is still read.
+*/
+class scan_filter {
+private:
+    glob_set _include;
+    glob_set _exclude;
+    unsigned _max_depth;
+    int64_t _newer_than_ns;
+    bool _newer_than;
+
+public:
+    /**
+     * @brief Constructor for the scan_filter
+     *
+     * @param include Patterns of the files to list, all files if empty
+     * @param exclude Patterns of the files and directories to skip
+     * @param maxDepth The number of directory levels read, 1 is only the scanned directory, 0 is unlimited
+     * @param newerThan Only list files modified after this time, see parse_time, no limit if empty
+     * @throws std::runtime_error if a pattern or the time is not valid
+    */
+    scan_filter(const std::vector<std::string>& include, const std::vector<std::string>& exclude,
+                unsigned maxDepth, const std::string& newerThan);
+
+    /**
+     * @brief Parses the time of --newer-than
+     *
+     * Accepts an age like 90s, 30m, 12h, 7d or 2w, a local date and time
+     * like 2024-05-01 or 2024-05-01T13:30[:00], or the path of a file whose
+     * modification time is used.
+     *
+     * @param text The time
+     * @returns The time in nanoseconds since the epoch
+     * @throws std::runtime_error if the text is none of the above
+    */
+    static int64_t parse_time(const std::string& text);
+
+    /**
+     * @brief Splits a comma separated list of patterns, empty parts are skipped
+    */
+    static std::vector<std::string> split_list(const std::string& list);
+
+    /**
+     * @brief Checks whether a subdirectory is read
+     *
+     * @param path The path of the subdirectory relative to the scanned directory
+     * @param name The name of the subdirectory
+     * @param depth The depth of the subdirectory, 1 for the subdirectories of the scanned directory
+    */
+    [[nodiscard]] bool descend(std::string_view path, std::string_view name, unsigned depth) const;
+
+    /**
+     * @brief Checks the patterns of a file, the age is checked by newer
+     *
+     * @param path The path of the file relative to the scanned directory
+     * @param name The name of the file
+    */
+    [[nodiscard]] bool select(std::string_view path, std::string_view name) const;
+
+    /**
+     * @brief Checks the modification time of a file if there is a limit
+     *
+     * @param file The full path of the file
+     * @returns true if there is no limit or the file was modified after it, false if it cannot be stat'ed
+    */
+    [[nodiscard]] bool newer(const std::string& file) const;
+};
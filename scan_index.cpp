@@ -0,0 +1,180 @@
+/**
+* @file scan_index.cpp
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the implementations of the scan_index class.
+ *
+ * Remembers directory listings between scans.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "scan_index.h"
+
+namespace {
+    const char MAGIC[8] = {'M', 'R', 'I', 'N', 'D', 'E', 'X', '2'};
+    const int64_t RACY_WINDOW_NS = 2'000'000'000;
+    /** @brief Bytes of a record with an empty name and empty listings: four lengths and three stamps */
+    const size_t MIN_RECORD_SIZE = 4 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+
+    /**
+     * @brief Minimal reader for the index file, every read checks the bounds
+    */
+    class index_parser {
+    private:
+        const char* _position;
+        const char* _end;
+    public:
+        index_parser(const char* data, size_t size) : _position(data), _end(data + size) {}
+
+        [[nodiscard]] size_t remaining() const { return static_cast<size_t>(_end - _position); }
+
+        template <typename T>
+        bool read(T& value) {
+            if (remaining() < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(&value, _position, sizeof(T));
+            _position += sizeof(T);
+            return true;
+        }
+
+        bool read(std::string& value) {
+            uint32_t length;
+            if (!read(length) || remaining() < length) {
+                return false;
+            }
+            value.assign(_position, length);
+            _position += length;
+            return true;
+        }
+
+        bool read(std::vector<std::string>& values) {
+            uint32_t count;
+            // every value takes at least its length, a larger count is damage and must not be allocated
+            if (!read(count) || remaining() / sizeof(uint32_t) < count) {
+                return false;
+            }
+            values.resize(count);
+            for (auto& value : values) {
+                if (!read(value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    template <typename T>
+    void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write(std::ostream& out, const std::string& value) {
+        write(out, static_cast<uint32_t>(value.size()));
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    void write(std::ostream& out, const std::vector<std::string>& values) {
+        write(out, static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            write(out, value);
+        }
+    }
+}
+
+scan_index::scan_index(const std::filesystem::path &path) : _path(path) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    _racy_after_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - RACY_WINDOW_NS;
+    load();
+}
+
+void scan_index::load() {
+    std::ifstream in(_path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return;
+    }
+    // in one read, the index of a large tree has gigabytes
+    auto end = in.tellg();
+    if (end < 0) {
+        return;
+    }
+    auto size = static_cast<size_t>(end);
+    auto data = std::make_unique_for_overwrite<char[]>(size);
+    if (!in.seekg(0) || !in.read(data.get(), static_cast<std::streamsize>(size))) {
+        return;
+    }
+    index_parser parser(data.get(), size);
+    char magic[sizeof(MAGIC)];
+    uint64_t count;
+    if (!parser.read(magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !parser.read(count) ||
+            parser.remaining() / MIN_RECORD_SIZE < count) {
+        return;
+    }
+    _previous.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        std::string directory;
+        record r;
+        if (!parser.read(directory) || !parser.read(r.stamp.inode) || !parser.read(r.stamp.mtime_ns) ||
+                !parser.read(r.stamp.ctime_ns) || !parser.read(r.listing.files) || !parser.read(r.listing.directories) ||
+                !parser.read(r.listing.links)) {
+            // a damaged index is as good as none
+            _previous.clear();
+            return;
+        }
+        _previous.emplace(std::move(directory), std::move(r));
+    }
+}
+
+bool scan_index::lookup(const std::string &directory, const directory_stamp &stamp, directory_listing &listing) {
+    // the map itself is not modified, threads looking up other directories do not see the record
+    auto it = _previous.find(directory);
+    if (it == _previous.end() || !(it->second.stamp == stamp)) {
+        return false;
+    }
+    listing = std::move(it->second.listing);
+    it->second.stamp = {};
+    return true;
+}
+
+void scan_index::store(const std::string &directory, const directory_stamp &stamp, directory_listing &&listing) {
+    record r{stamp, std::move(listing)};
+    if (stamp.mtime_ns >= _racy_after_ns || stamp.ctime_ns >= _racy_after_ns) {
+        r.stamp.mtime_ns = 0;
+    }
+    std::lock_guard lock(_mutex);
+    _current.insert_or_assign(directory, std::move(r));
+}
+
+void scan_index::save() {
+    auto temp = _path;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::filesystem::filesystem_error("Could not write scan index", temp,
+                                                    std::make_error_code(std::errc::io_error));
+        }
+        std::lock_guard lock(_mutex);
+        out.write(MAGIC, sizeof(MAGIC));
+        write(out, static_cast<uint64_t>(_current.size()));
+        for (const auto &[directory, r]: _current) {
+            write(out, directory);
+            write(out, r.stamp.inode);
+            write(out, r.stamp.mtime_ns);
+            write(out, r.stamp.ctime_ns);
+            write(out, r.listing.files);
+            write(out, r.listing.directories);
+            write(out, r.listing.links);
+        }
+        out.flush();
+        if (!out) {
+            throw std::filesystem::filesystem_error("Could not write scan index", temp,
+                                                    std::make_error_code(std::errc::io_error));
+        }
+    }
+    std::filesystem::rename(temp, _path);
+}
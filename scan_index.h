@@ -0,0 +1,113 @@
+/**
+* @file scan_index.h
+ * @author Stefan Kleinschmidt
+ * @date 17. Oct 2026
+ * @brief Contains the definition of the scan_index class.
+ *
+ * Remembers directory listings between scans.
+ */
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The entries of a directory the scan is interested in
+*/
+struct directory_listing {
+    /** @brief Names of the regular files */
+    std::vector<std::string> files;
+    /** @brief Names of the subdirectories */
+    std::vector<std::string> directories;
+    /** @brief Names of the symlinks pointing to directories, only walked when following symlinks */
+    std::vector<std::string> links;
+};
+
+/**
+ * @brief Timestamps identifying the state of a directory
+*/
+struct directory_stamp {
+    uint64_t inode{0};
+    int64_t mtime_ns{0};
+    int64_t ctime_ns{0};
+
+    bool operator==(const directory_stamp&) const = default;
+};
+
+/**
+ * @brief Persistent index of directory listings for incremental scans
+ *
+ * Stores the listing of every scanned directory together with its inode,
+ * mtime and ctime. Creating, deleting or renaming an entry changes the
+ * mtime of the directory, so as long as the stamp is unchanged, a rescan
+ * can take the listing from the index instead of reading the directory.
+ * Changes to files themselves, or to the target of a symlink, do not
+ * touch the directory and are not detected.
+ *
+ * A directory modified less than two seconds before it was read may be
+ * modified again within the same timestamp tick, so its stamp is not
+ * trusted on the next scan.
+ *
+ * lookup() takes the listings out of the index loaded at construction,
+ * store() builds the index for the next scan, so an unchanged listing is
+ * moved along instead of copied. Both can be called from several threads,
+ * every directory is looked up at most once.
+*/
+class scan_index {
+private:
+    struct record {
+        directory_stamp stamp;
+        directory_listing listing;
+    };
+
+    std::filesystem::path _path;
+    std::unordered_map<std::string, record> _previous;
+    std::unordered_map<std::string, record> _current;
+    std::mutex _mutex;
+    int64_t _racy_after_ns;
+
+    void load();
+
+public:
+    /**
+     * @brief Constructor for the scan_index, loads the index file if it exists
+     *
+     * A missing, unreadable or incompatible file is treated as an empty index.
+     *
+     * @param path The index file
+    */
+    explicit scan_index(const std::filesystem::path& path);
+
+    /**
+     * @brief Takes the listing of a directory out of the loaded index
+     *
+     * @param directory The directory
+     * @param stamp The current stamp of the directory
+     * @param listing Receives the listing if the stamp is unchanged, it is no longer in the loaded index then
+     * @returns true if the listing is still valid
+    */
+    bool lookup(const std::string& directory, const directory_stamp& stamp, directory_listing& listing);
+
+    /**
+     * @brief Stores the listing of a directory for the next scan
+     *
+     * @param directory The directory
+     * @param stamp The stamp the directory had before it was read
+     * @param listing The listing, moved into the index
+    */
+    void store(const std::string& directory, const directory_stamp& stamp, directory_listing&& listing);
+
+    /**
+     * @brief Replaces the index file with the stored listings
+    */
+    void save();
+
+    /**
+     * @brief The number of directories in the loaded index
+    */
+    [[nodiscard]] size_t previous_size() const { return _previous.size(); }
+};